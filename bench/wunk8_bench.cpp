@@ -0,0 +1,510 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <regex>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+#include "Wunk8.hpp"
+
+// Micro and macro benchmarks of the interpreter.
+// Microbenchmarks loop a single kind of instruction, macrobenchmarks run
+// whole programs for a fixed number of instructions. Results can be saved
+// as JSON and compared against a saved baseline.
+namespace
+{
+void PrintUsage(const char *Program)
+{
+	std::cout
+		<< "Usage: " << Program << " [options]" << std::endl
+		<< "Options:" << std::endl
+		<< "  --filter=REGEX     Only run benchmarks whose name matches" << std::endl
+		<< "  --min-time=SEC     Least time to run each microbenchmark(0.2)" << std::endl
+		<< "  --repetitions=N    Runs of each macrobenchmark, the fastest counts(3)" << std::endl
+		<< "  --ipf=N            Instructions per frame for frames/sec(10)" << std::endl
+		<< "  --json=FILE        Write results as JSON" << std::endl
+		<< "  --baseline=FILE    Compare against results written by --json" << std::endl
+		<< "                     (" WUNK8_BENCH_DIR "/baseline.json)" << std::endl
+		<< "  --threshold=PCT    Slowdown counted as a regression(10)" << std::endl
+		<< "  --check            Exit with failure upon any regression" << std::endl
+		<< "  --list             List benchmark names" << std::endl;
+}
+
+constexpr std::chrono::microseconds TickTime(1600);
+
+// Builds a program as a setup sequence run once, followed by a loop body of
+// generated instructions that jumps back to its start forever
+class Program
+{
+public:
+	Program()
+		:
+		Image(0x1000 - 0x200, 0),
+		Next(0x200)
+	{
+	}
+
+	void Emit(uint16_t Opcode)
+	{
+		Put(Next, Opcode);
+		Next += 2;
+	}
+
+	// Opcode gets the address it is placed at, for chains of jumps
+	void Loop(size_t Count, const std::function<uint16_t(uint16_t)> &Body)
+	{
+		const uint16_t Start = Next;
+		for( size_t i = 0; i < Count; i++ )
+		{
+			Emit(Body(Next));
+		}
+		Emit(static_cast<uint16_t>(0x1000 | Start));
+	}
+
+	void Put(uint16_t Address, uint16_t Opcode)
+	{
+		Image[Address - 0x200] = static_cast<uint8_t>(Opcode >> 8);
+		Image[Address - 0x200 + 1] = static_cast<uint8_t>(Opcode);
+	}
+
+	Wunk8::Chip8 Load() const
+	{
+		Wunk8::Chip8 Console;
+		Console.LoadGame(Image.data(), Image.size());
+		return Console;
+	}
+
+private:
+	std::vector<uint8_t> Image;
+	uint16_t Next;
+};
+
+// Loops are long enough that the closing jump barely counts
+constexpr size_t LoopLength = 512;
+
+Wunk8::Chip8 Repeat(std::vector<uint16_t> Setup, std::vector<uint16_t> Body)
+{
+	Program Code;
+	for( const uint16_t Opcode : Setup )
+	{
+		Code.Emit(Opcode);
+	}
+	Code.Loop(
+		LoopLength,
+		[&Body](uint16_t Address)
+		{
+			return Body[(Address / 2) % Body.size()];
+		}
+	);
+	return Code.Load();
+}
+
+// Straight-line instructions that stay clear of the program and never branch
+uint16_t RandomInstruction(uint32_t &State)
+{
+	State = State * 1664525 + 1013904223;
+	const uint16_t X = static_cast<uint16_t>((State >> 8) & 0xF);
+	const uint16_t Y = static_cast<uint16_t>((State >> 12) & 0xF);
+	const uint16_t NN = static_cast<uint16_t>((State >> 16) & 0xFF);
+	static constexpr uint16_t Alu[] = { 0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0xE };
+	switch( (State >> 24) % 10 )
+	{
+	case 0: return static_cast<uint16_t>(0x6000 | X << 8 | NN);
+	case 1: return static_cast<uint16_t>(0x7000 | X << 8 | NN);
+	case 2: return static_cast<uint16_t>(0x8000 | X << 8 | Y << 4 | Alu[NN % 9]);
+	case 3: return static_cast<uint16_t>(0xC000 | X << 8 | NN);
+	case 4: return static_cast<uint16_t>(0xD000 | X << 8 | Y << 4 | (NN & 0xF));
+	case 5: return static_cast<uint16_t>(0xF015 | X << 8);
+	// Stores go through I, so keep it well past the program
+	case 6: return static_cast<uint16_t>(0xAE00 | NN);
+	case 7: return static_cast<uint16_t>(0xF033 | X << 8);
+	case 8: return static_cast<uint16_t>(0xF065 | X << 8);
+	default: return static_cast<uint16_t>(0xF055 | X << 8);
+	}
+}
+
+struct Benchmark
+{
+	std::string Name;
+	// Macrobenchmarks run exactly this many instructions, microbenchmarks
+	// run for a minimum time instead
+	uint64_t Instructions;
+	std::function<Wunk8::Chip8()> Setup;
+	// Held for the whole run
+	uint16_t Keys;
+};
+
+std::vector<Benchmark> GetBenchmarks()
+{
+	std::vector<Benchmark> Result;
+	const auto Micro = [&Result](const std::string &Name, std::function<Wunk8::Chip8()> Setup)
+	{
+		Result.push_back(Benchmark{ "micro/" + Name, 0, Setup, 0 });
+	};
+	const auto Simple = [&Micro](
+		const std::string &Name, std::vector<uint16_t> Setup, std::vector<uint16_t> Body
+	)
+	{
+		Micro(Name, [Setup, Body]() { return Repeat(Setup, Body); });
+	};
+
+	Simple("00E0_cls", {}, { 0x00E0 });
+	Micro(
+		"2NNN_00EE_call_ret",
+		[]()
+		{
+			Program Code;
+			Code.Put(0xF00, 0x00EE);
+			Code.Loop(LoopLength, [](uint16_t) { return 0x2F00; });
+			return Code.Load();
+		}
+	);
+	Micro(
+		"1NNN_jump",
+		[]()
+		{
+			Program Code;
+			Code.Loop(LoopLength, [](uint16_t Address) { return 0x1000 | (Address + 2); });
+			return Code.Load();
+		}
+	);
+	Micro(
+		"BNNN_jump_offset",
+		[]()
+		{
+			Program Code;
+			Code.Emit(0x6000);
+			Code.Loop(LoopLength, [](uint16_t Address) { return 0xB000 | (Address + 2); });
+			return Code.Load();
+		}
+	);
+	Simple("3XNN_4XNN_skip", { 0x6000, 0x6101 }, { 0x3001, 0x4101 });
+	Simple("5XY0_9XY0_skip", { 0x6000, 0x6101 }, { 0x5010, 0x9000 });
+	Simple("6XNN_load", {}, { 0x6012, 0x6134, 0x6256, 0x6378 });
+	Simple("7XNN_add", {}, { 0x7001, 0x7102, 0x7203, 0x7304 });
+	Simple(
+		"8XYN_alu",
+		{ 0x6012, 0x6134 },
+		{ 0x8010, 0x8011, 0x8012, 0x8013, 0x8014, 0x8015, 0x8016, 0x8017, 0x801E }
+	);
+	Simple("ANNN_index", {}, { 0xAE00, 0xAE10 });
+	Simple("CXNN_random", {}, { 0xC0FF, 0xC10F });
+	for( uint16_t Height = 1; Height <= 15; Height++ )
+	{
+		std::ostringstream Name;
+		Name << "DXYN_draw/" << Height;
+		Simple(Name.str(), { 0x6008, 0x6104, 0xA000 }, { static_cast<uint16_t>(0xD010 | Height) });
+	}
+	Simple("EX9E_EXA1_keys", { 0x6001 }, { 0xE09E, 0xE0A1 });
+	Simple("FX07_FX15_timers", { 0x6010 }, { 0xF015, 0xF107 });
+	Simple("FX1E_index_add", { 0x6001 }, { 0xF01E });
+	Simple("FX29_font", { 0x6007 }, { 0xF029 });
+	Simple("FX33_bcd", { 0x60FE, 0xAE00 }, { 0xF033 });
+	Simple("FX55_store", { 0xAE00 }, { 0xFF55 });
+	Simple("FX65_load", { 0xAE00 }, { 0xFF65 });
+
+	const auto Macro = [&Result](
+		const std::string &Name, uint64_t Instructions, std::function<Wunk8::Chip8()> Setup,
+		uint16_t Keys
+	)
+	{
+		Result.push_back(Benchmark{ "macro/" + Name, Instructions, Setup, Keys });
+	};
+	Macro(
+		"PONG", 2000000,
+		[]()
+		{
+			Wunk8::Chip8 Console;
+			if( !Console.LoadGame(std::string(WUNK8_BENCH_DIR "/../PONG")) )
+			{
+				std::cerr << "Unable to open PONG" << std::endl;
+			}
+			return Console;
+		},
+		// Hold the left paddle's up key so the game keeps reading input
+		1 << 0x1
+	);
+	Macro(
+		"synthetic/alu", 2000000,
+		[]()
+		{
+			return Repeat(
+				{ 0x6012, 0x6134 },
+				{ 0x7001, 0x8014, 0x8125, 0x8016, 0x810E, 0x6233, 0x8203, 0x3199 }
+			);
+		},
+		0
+	);
+	Macro(
+		"synthetic/sprites", 2000000,
+		[]()
+		{
+			return Repeat(
+				{ 0xA000 },
+				{ 0x7003, 0x7101, 0xD015, 0xF029, 0xD01F, 0x00E0, 0xD018, 0x8104 }
+			);
+		},
+		0
+	);
+	Macro(
+		"synthetic/memory", 2000000,
+		[]()
+		{
+			return Repeat({ 0x6001 }, { 0xAE00, 0xF033, 0xFF55, 0xF01E, 0xF765, 0xF11E, 0xF365 });
+		},
+		0
+	);
+	Macro(
+		"synthetic/random", 2000000,
+		[]()
+		{
+			uint32_t State = 0x5EED;
+			Program Code;
+			Code.Loop(LoopLength * 2, [&State](uint16_t) { return RandomInstruction(State); });
+			return Code.Load();
+		},
+		0
+	);
+
+	Result.push_back(Benchmark{ "micro/Reset", 0, []() { return Wunk8::Chip8(); }, 0 });
+	return Result;
+}
+
+struct Measurement
+{
+	uint64_t Instructions;
+	double Seconds;
+};
+
+Measurement RunMicro(const Benchmark &Bench, double MinTime)
+{
+	using Clock = std::chrono::steady_clock;
+	const Wunk8::Chip8 Initial = Bench.Setup();
+	Wunk8::Chip8 Console = Initial;
+	const bool IsReset = Bench.Name == "micro/Reset";
+	// Warm up caches and branch predictors
+	for( uint32_t i = 0; i < 10000; i++ )
+	{
+		Console.Tick(TickTime);
+	}
+	Measurement Result = { 0, 0.0 };
+	uint64_t Batch = 1000;
+	while( Result.Seconds < MinTime )
+	{
+		const Clock::time_point Start = Clock::now();
+		for( uint64_t i = 0; i < Batch; i++ )
+		{
+			if( IsReset )
+			{
+				Console.Reset();
+			}
+			else
+			{
+				Console.Tick(TickTime);
+			}
+		}
+		Result.Seconds += std::chrono::duration<double>(Clock::now() - Start).count();
+		Result.Instructions += Batch;
+		Batch = std::min<uint64_t>(Batch * 2, 1 << 22);
+	}
+	return Result;
+}
+
+Measurement RunMacro(const Benchmark &Bench, uint32_t Repetitions)
+{
+	using Clock = std::chrono::steady_clock;
+	const Wunk8::Chip8 Initial = Bench.Setup();
+	Measurement Best = { Bench.Instructions, 0.0 };
+	for( uint32_t Repetition = 0; Repetition < std::max<uint32_t>(1, Repetitions); Repetition++ )
+	{
+		Wunk8::Chip8 Console = Initial;
+		Console.KeyDown(Bench.Keys);
+		const Clock::time_point Start = Clock::now();
+		for( uint64_t i = 0; i < Bench.Instructions; i++ )
+		{
+			Console.Tick(TickTime);
+		}
+		const double Seconds = std::chrono::duration<double>(Clock::now() - Start).count();
+		Best.Seconds = Repetition == 0 ? Seconds : std::min(Best.Seconds, Seconds);
+	}
+	return Best;
+}
+
+// Reads the ns_per_instruction of each benchmark from a file written by
+// --json. Only understands that output, not JSON in general.
+std::map<std::string, double> ReadBaseline(const std::string &FileName)
+{
+	std::map<std::string, double> Result;
+	std::ifstream File(FileName);
+	std::string Line;
+	std::string Name;
+	while( std::getline(File, Line) )
+	{
+		const size_t Colon = Line.find(':');
+		if( Colon == std::string::npos )
+		{
+			continue;
+		}
+		if( Line.find("\"name\"") != std::string::npos )
+		{
+			const size_t Open = Line.find('"', Colon);
+			const size_t Close = Line.find('"', Open + 1);
+			Name = Line.substr(Open + 1, Close - Open - 1);
+		}
+		else if( Line.find("\"ns_per_instruction\"") != std::string::npos && !Name.empty() )
+		{
+			Result[Name] = std::strtod(Line.c_str() + Colon + 1, nullptr);
+		}
+	}
+	return Result;
+}
+}
+
+int main(int argc, char *argv[])
+{
+	std::string Filter = ".*";
+	double MinTime = 0.2;
+	uint32_t Repetitions = 3;
+	uint32_t InstructionsPerFrame = 10;
+	std::string JsonPath;
+	std::string BaselinePath = WUNK8_BENCH_DIR "/baseline.json";
+	double Threshold = 10.0;
+	bool Check = false;
+	bool List = false;
+	for( int i = 1; i < argc; i++ )
+	{
+		const std::string Arg(argv[i]);
+		if( Arg.compare(0, 9, "--filter=") == 0 )
+		{
+			Filter = Arg.substr(9);
+		}
+		else if( Arg.compare(0, 11, "--min-time=") == 0 )
+		{
+			MinTime = std::strtod(Arg.c_str() + 11, nullptr);
+		}
+		else if( Arg.compare(0, 14, "--repetitions=") == 0 )
+		{
+			Repetitions = static_cast<uint32_t>(std::strtoul(Arg.c_str() + 14, nullptr, 10));
+		}
+		else if( Arg.compare(0, 6, "--ipf=") == 0 )
+		{
+			InstructionsPerFrame = std::max<uint32_t>(
+				1, static_cast<uint32_t>(std::strtoul(Arg.c_str() + 6, nullptr, 10))
+			);
+		}
+		else if( Arg.compare(0, 7, "--json=") == 0 )
+		{
+			JsonPath = Arg.substr(7);
+		}
+		else if( Arg.compare(0, 11, "--baseline=") == 0 )
+		{
+			BaselinePath = Arg.substr(11);
+		}
+		else if( Arg.compare(0, 12, "--threshold=") == 0 )
+		{
+			Threshold = std::strtod(Arg.c_str() + 12, nullptr);
+		}
+		else if( Arg == "--check" )
+		{
+			Check = true;
+		}
+		else if( Arg == "--list" )
+		{
+			List = true;
+		}
+		else
+		{
+			PrintUsage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	const std::regex Pattern(Filter);
+	const std::map<std::string, double> Baseline = ReadBaseline(BaselinePath);
+	if( !Baseline.empty() && !List )
+	{
+		std::cout << "Comparing against " << BaselinePath << std::endl;
+	}
+
+	std::ostringstream Json;
+	Json << "{\n\t\"benchmarks\": [";
+	bool FirstResult = true;
+	size_t Regressions = 0;
+	std::cout
+		<< std::left << std::setw(32) << "Benchmark" << std::right
+		<< std::setw(12) << "ns/instr" << std::setw(10) << "MIPS"
+		<< std::setw(14) << "frames/s" << std::setw(12) << "baseline" << std::endl
+		<< std::string(80, '-') << std::endl;
+	for( const Benchmark &Bench : GetBenchmarks() )
+	{
+		if( !std::regex_search(Bench.Name, Pattern) )
+		{
+			continue;
+		}
+		if( List )
+		{
+			std::cout << Bench.Name << std::endl;
+			continue;
+		}
+		const Measurement Result = Bench.Instructions
+			? RunMacro(Bench, Repetitions) : RunMicro(Bench, MinTime);
+		const double Nanoseconds = Result.Seconds * 1e9 / Result.Instructions;
+		const double Mips = Result.Instructions / Result.Seconds / 1e6;
+		const double FramesPerSecond = Result.Instructions / Result.Seconds / InstructionsPerFrame;
+
+		std::cout
+			<< std::left << std::setw(32) << Bench.Name << std::right << std::fixed
+			<< std::setprecision(3) << std::setw(12) << Nanoseconds
+			<< std::setprecision(1) << std::setw(10) << Mips
+			<< std::setprecision(0) << std::setw(14) << FramesPerSecond;
+		const auto Found = Baseline.find(Bench.Name);
+		if( Found != Baseline.end() && Found->second > 0.0 )
+		{
+			// Positive when slower than the baseline
+			const double Change = (Nanoseconds / Found->second - 1.0) * 100.0;
+			std::cout << std::setprecision(1) << std::setw(10) << std::showpos << Change << '%'
+				<< std::noshowpos;
+			if( Change > Threshold )
+			{
+				std::cout << " REGRESSION";
+				Regressions++;
+			}
+		}
+		std::cout << std::endl;
+
+		Json
+			<< (FirstResult ? "\n" : ",\n")
+			<< "\t\t{\n"
+			<< "\t\t\t\"name\": \"" << Bench.Name << "\",\n"
+			<< "\t\t\t\"instructions\": " << Result.Instructions << ",\n"
+			<< "\t\t\t\"seconds\": " << Result.Seconds << ",\n"
+			<< "\t\t\t\"ns_per_instruction\": " << Nanoseconds << ",\n"
+			<< "\t\t\t\"mips\": " << Mips << ",\n"
+			<< "\t\t\t\"frames_per_second\": " << FramesPerSecond << "\n"
+			<< "\t\t}";
+		FirstResult = false;
+	}
+	Json << "\n\t]\n}\n";
+
+	if( !JsonPath.empty() )
+	{
+		std::ofstream Out(JsonPath);
+		Out << Json.str();
+		if( !Out.good() )
+		{
+			std::cerr << "Failed to write " << JsonPath << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	if( Regressions != 0 )
+	{
+		std::cout << Regressions << " benchmarks regressed by more than " << Threshold << '%' << std::endl;
+	}
+	return Check && Regressions != 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
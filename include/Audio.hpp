@@ -0,0 +1,197 @@
+#pragma once
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "RingBuffer.hpp"
+
+namespace Wunk8
+{
+class Chip8;
+
+// Mono signed 16-bit PCM, about 0.75 seconds at 44.1khz
+using AudioBuffer = RingBuffer<int16_t, 1 << 15>;
+
+// Produces PCM samples from the emulated sound hardware. Lives on the
+// emulation thread and is advanced in lockstep with Chip8::Tick, so every
+// sample lines up with the instruction that was executing at that time.
+class Synthesizer
+{
+public:
+	Synthesizer(AudioBuffer &Output, uint32_t SampleRate = 44100);
+
+	// Renders the samples covering DeltaTime. Call after each Chip8::Tick
+	// with the same DeltaTime.
+	void Advance(const Chip8 &Console, std::chrono::microseconds DeltaTime);
+
+	struct Stats
+	{
+		uint64_t Samples;
+		// Samples dropped because the output buffer was full
+		uint64_t Overruns;
+	};
+
+	Stats GetStats() const
+	{
+		return {
+			Samples.load(std::memory_order_relaxed),
+			Overruns.load(std::memory_order_relaxed)
+		};
+	}
+
+	uint32_t GetSampleRate() const
+	{
+		return SampleRate;
+	}
+
+	// Square wave used when no XO-CHIP pattern has been loaded
+	static constexpr uint32_t ToneFrequency = 440;
+	static constexpr int16_t Amplitude = 0x2000;
+
+private:
+	void Render(const Chip8 &Console, int16_t *Buffer, size_t Count);
+
+	AudioBuffer &Output;
+	const uint32_t SampleRate;
+
+	// Microseconds * SampleRate not yet turned into a whole sample
+	uint64_t Remainder;
+
+	// 32-bit phase accumulators, one full turn per waveform period
+	uint32_t TonePhase;
+	uint32_t ToneStep;
+	// Upper 7 bits index the 128-bit pattern
+	uint32_t PatternPhase;
+	uint32_t PatternStep;
+	int PatternPitch;
+
+	std::atomic<uint64_t> Samples;
+	std::atomic<uint64_t> Overruns;
+};
+
+// Destination for rendered samples
+class AudioSink
+{
+public:
+	virtual ~AudioSink();
+
+	virtual void Write(const int16_t *Buffer, size_t Count) = 0;
+
+	// Realtime sinks are fed at the sample rate, and run dry when
+	// emulation falls behind. Other sinks take samples as they come.
+	virtual bool IsRealtime() const
+	{
+		return false;
+	}
+};
+
+// RIFF WAVE file, the header is completed upon destruction
+class WavSink : public AudioSink
+{
+public:
+	WavSink(const std::string &FileName, uint32_t SampleRate);
+	~WavSink() override;
+
+	bool IsOpen() const
+	{
+		return File != nullptr;
+	}
+
+	void Write(const int16_t *Buffer, size_t Count) override;
+
+private:
+	void WriteHeader();
+
+	FILE *File;
+	uint32_t SampleRate;
+	uint64_t DataSize;
+};
+
+// Headerless PCM, such as stdout piped into an audio player
+class RawSink : public AudioSink
+{
+public:
+	RawSink(FILE *Stream = stdout);
+
+	void Write(const int16_t *Buffer, size_t Count) override;
+
+	bool IsRealtime() const override
+	{
+		return true;
+	}
+
+private:
+	FILE *Stream;
+};
+
+// Discards samples
+class NullSink : public AudioSink
+{
+public:
+	NullSink()
+		:
+		Written(0)
+	{
+	}
+
+	void Write(const int16_t *Buffer, size_t Count) override
+	{
+		(void)Buffer;
+		Written += Count;
+	}
+
+	uint64_t GetSamples() const
+	{
+		return Written;
+	}
+
+private:
+	uint64_t Written;
+};
+
+// Drains an AudioBuffer into a sink from its own thread
+class AudioOutput
+{
+public:
+	AudioOutput(AudioBuffer &Input, AudioSink &Sink, uint32_t SampleRate);
+	// Writes out whatever is still buffered
+	~AudioOutput();
+
+	AudioOutput(const AudioOutput&) = delete;
+	AudioOutput& operator=(const AudioOutput&) = delete;
+
+	struct Stats
+	{
+		uint64_t Samples;
+		// Periods a realtime sink had to be padded with silence
+		uint64_t Underruns;
+	};
+
+	Stats GetStats() const
+	{
+		return {
+			Samples.load(std::memory_order_relaxed),
+			Underruns.load(std::memory_order_relaxed)
+		};
+	}
+
+	// Samples handed to the sink at once
+	static constexpr size_t Period = 512;
+
+private:
+	void Run();
+	void Drain();
+
+	AudioBuffer &Input;
+	AudioSink &Sink;
+	const uint32_t SampleRate;
+
+	std::atomic<bool> Running;
+	std::atomic<uint64_t> Samples;
+	std::atomic<uint64_t> Underruns;
+	std::thread Thread;
+};
+}
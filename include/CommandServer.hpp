@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "Wunk8.hpp"
+
+namespace Wunk8
+{
+// Drives one console on behalf of another process through a compact binary
+// protocol, so a harness can run many scenarios without starting wunk8 for
+// each of them.
+//
+// Every message is a little-endian uint32 length followed by that many
+// bytes. Requests start with a command byte, responses with a status byte,
+// followed by the arguments or results listed below.
+//   Load      0x01 rom bytes          Resets and loads a program
+//   Reset     0x02                    Returns to the state after Load
+//   Step      0x03 u32 instructions   Returns u64 cycles afterwards
+//   Keys      0x04 u16 mask           Holds bit n for key n
+//   Snapshot  0x05 u32 slot           Stores the state in a numbered slot
+//   Restore   0x06 u32 slot           Loads the state of a slot, keeping keys
+//   Screen    0x07                    Returns 256 bytes, 1 bit per pixel
+//   Memory    0x08 u16 address, u16 length  Returns the bytes
+//   Hash      0x09                    Returns u64 state hash
+//   Quit      0x0A                    Ends the session
+class CommandServer
+{
+public:
+	enum class Command : uint8_t
+	{
+		Load = 0x01,
+		Reset = 0x02,
+		Step = 0x03,
+		Keys = 0x04,
+		Snapshot = 0x05,
+		Restore = 0x06,
+		Screen = 0x07,
+		Memory = 0x08,
+		Hash = 0x09,
+		Quit = 0x0A
+	};
+
+	enum class Status : uint8_t
+	{
+		Ok = 0x00,
+		UnknownCommand = 0x01,
+		BadArguments = 0x02,
+		OutOfRange = 0x03
+	};
+
+	explicit CommandServer(uint32_t InstructionsPerFrame);
+
+	// Serves requests read from In with responses written to Out until Quit
+	// or end of input, returning false on an I/O error
+	bool Serve(int In, int Out);
+
+	// Serves one client at a time on a Unix domain socket at Path until a
+	// client quits. The console carries over from one client to the next.
+	bool Listen(const std::string &Path);
+
+private:
+	bool Handle(const std::vector<uint8_t> &Request, std::vector<uint8_t> &Response);
+
+	const uint32_t InstructionsPerFrame;
+	Chip8 Console;
+	// State right after the last Load
+	Chip8 Initial;
+	std::vector<Chip8> Slots;
+	bool Quit;
+};
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include <string>
+#include <stdint.h>
+
+namespace Wunk8
+{
+// Assembly text of a single Chip8 instruction, such as "DRW V1, V2, 5"
+std::string Disassemble(uint16_t Opcode);
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <stdint.h>
+#include <chrono>
+
+namespace Wunk8
+{
+// Paces emulated frames against absolute steady_clock deadlines so that
+// emulation and presentation cost never accumulate into drift.
+//
+// Each deadline is one period after the previous one rather than after
+// whenever the previous frame finished. Most of the wait is spent in
+// sleep_until and the final stretch is spun to hide scheduler wake-up
+// latency. Frames that finish late are caught up by running the following
+// frames back to back without presenting them, and falling too far behind
+// gives up on the lost time instead of fast-forwarding through it.
+class FramePacer
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	explicit FramePacer(
+		std::chrono::microseconds Period = std::chrono::milliseconds(16)
+	);
+
+	// Restarts pacing from the current time
+	void Reset();
+
+	// Emulated time runs this many times faster than real time
+	void SetSpeed(double Multiplier);
+	double GetSpeed() const
+	{
+		return Speed;
+	}
+
+	// Runs as fast as possible, presenting at most one frame per period
+	void SetTurbo(bool Enabled);
+	bool IsTurbo() const
+	{
+		return Turbo;
+	}
+
+	// Presents only one of every Skip + 1 frames
+	void SetFrameSkip(uint32_t Skip)
+	{
+		FrameSkip = Skip;
+	}
+
+	// Time before a deadline spent spinning rather than sleeping
+	void SetSpinTail(std::chrono::microseconds Tail)
+	{
+		SpinTail = Tail;
+	}
+
+	// Host time the frame about to be emulated is paced to start at
+	Clock::time_point GetFrameStart() const
+	{
+		return Deadline;
+	}
+
+	// Host time each frame is paced to take at the current speed
+	Clock::duration GetScaledPeriod() const;
+
+	// Whether the frame just emulated should be presented. Call once per
+	// frame, before Wait.
+	bool ShouldPresent();
+
+	// Blocks until the current frame's deadline
+	void Wait();
+
+	struct Stats
+	{
+		uint64_t Frames;
+		uint64_t Presented;
+		// Frames not presented to catch up, for turbo or for frameskip
+		uint64_t Skipped;
+		// Frames that finished after their deadline
+		uint64_t Late;
+		// Periods given up on after falling too far behind
+		uint64_t Dropped;
+		// Signed distance of the last wake-up from its deadline, positive
+		// when late
+		std::chrono::nanoseconds LastError;
+		// Largest distance of any wake-up from its deadline
+		std::chrono::nanoseconds MaxError;
+	};
+
+	const Stats& GetStats() const
+	{
+		return Statistics;
+	}
+
+	// Allowed lag before pacing restarts from the current time
+	static constexpr uint32_t MaxCatchUpFrames = 4;
+
+private:
+	const std::chrono::microseconds Period;
+	double Speed;
+	bool Turbo;
+	uint32_t FrameSkip;
+	std::chrono::microseconds SpinTail;
+
+	Clock::time_point Deadline;
+	Clock::time_point NextTurboPresent;
+	uint32_t CatchUpSkips;
+
+	Stats Statistics;
+};
+}
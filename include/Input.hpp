@@ -0,0 +1,175 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "RingBuffer.hpp"
+
+namespace Wunk8
+{
+class Chip8;
+struct ReplayEvent;
+
+struct InputEvent
+{
+	// Instruction count at which the event takes effect, left to InputMux by
+	// live sources
+	uint64_t Cycle;
+	// Host time a live event arrived at
+	std::chrono::steady_clock::time_point Time;
+	// Keypad key, 0x0 to 0xF
+	uint8_t Key;
+	bool Pressed;
+};
+
+// Events from a single source in non-decreasing Cycle order, or Time order
+// for live sources
+using InputQueue = RingBuffer<InputEvent, 1024>;
+
+// Maps a host key to the keypad key at the same position, or -1
+//  1 2 3 4     1 2 3 C
+//  q w e r  -> 4 5 6 D
+//  a s d f     7 8 9 E
+//  z x c v     A 0 B F
+int KeypadFromChar(int Char);
+
+// Producer of input events, each owning the queue it pushes into
+class InputSource
+{
+public:
+	virtual ~InputSource();
+
+	InputQueue& GetQueue()
+	{
+		return Queue;
+	}
+
+	// Live sources stamp events with the host time they arrived at, which
+	// InputMux converts to a cycle. Scripted sources know their cycles ahead
+	// of time, so emulation may not run past
+	// the end of their queue until they are finished.
+	bool IsLive() const
+	{
+		return Live;
+	}
+
+	// No further events will be pushed
+	bool IsFinished() const
+	{
+		return Finished.load(std::memory_order_acquire);
+	}
+
+protected:
+	explicit InputSource(bool Live);
+
+	// Waits while the queue is full, returns false once stopping
+	bool Push(const InputEvent &Event);
+	void Finish();
+	void Stop();
+
+	std::atomic<bool> Running;
+	std::thread Thread;
+
+private:
+	InputQueue Queue;
+	const bool Live;
+	std::atomic<bool> Finished;
+};
+
+// Applies queued events to the console on the emulation thread, merged
+// across sources in cycle order
+class InputMux
+{
+public:
+	InputMux();
+
+	// Sources must outlive the mux and be added before emulation starts
+	void AddSource(InputSource &Source);
+
+	// Live events are placed at the instruction matching their host time,
+	// with each frame of InstructionsPerFrame instructions taking Period
+	void SetFrameLength(std::chrono::steady_clock::duration Period, uint32_t InstructionsPerFrame);
+
+	// Called before emulating each frame with the console's cycle and the
+	// host time the frame is paced to start at
+	void BeginFrame(uint64_t FrameCycle, std::chrono::steady_clock::time_point FrameStart);
+
+	// Applies every event due at or before the console's current cycle and
+	// returns the cycle of the next known event, UINT64_MAX if none is known.
+	// Run no further than that before applying again.
+	uint64_t Apply(Chip8 &Console);
+
+	// Writes every applied event in the replay format
+	bool Record(const std::string &FileName);
+
+private:
+	// Cycle of a live event, no earlier than Now
+	uint64_t GetLiveCycle(const InputEvent &Event, uint64_t Now) const;
+
+	std::vector<InputSource*> Sources;
+	std::chrono::steady_clock::duration FramePeriod;
+	uint32_t InstructionsPerFrame;
+	uint64_t FrameCycle;
+	std::chrono::steady_clock::time_point FrameStart;
+	std::ofstream Recording;
+};
+
+// Events pushed by the caller, such as the window's key events
+class LiveInput : public InputSource
+{
+public:
+	LiveInput();
+
+	// Dropped if the queue is full
+	bool Press(uint8_t Key, bool Pressed);
+};
+
+// Replays a recording in the format of Replay.hpp
+class ReplayInput : public InputSource
+{
+public:
+	ReplayInput();
+	~ReplayInput();
+
+	// Reads the whole recording up front, ordered by cycle the same way as
+	// ReadReplay for every other tool that replays it
+	bool Open(const std::string &FileName);
+
+private:
+	void Run(const std::vector<ReplayEvent> &Events);
+};
+
+// Presses and releases random keys at random intervals, reproducibly for
+// the same seed
+class BotInput : public InputSource
+{
+public:
+	BotInput();
+	~BotInput();
+
+	void Start(uint32_t Seed);
+
+private:
+	void Run(uint32_t Seed);
+};
+
+// Accepts "down K" and "up K" lines from one loopback TCP client at a time
+class SocketInput : public InputSource
+{
+public:
+	SocketInput();
+	~SocketInput();
+
+	// Listens on 127.0.0.1:Port, returns false if the port is unavailable
+	bool Start(uint16_t Port);
+
+private:
+	void Run();
+
+	int Listener;
+};
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+
+namespace Wunk8
+{
+// Loopback TCP listeners served by a thread that must notice being stopped.
+// Sockets are plain descriptors, and every call fails on platforms without
+// BSD sockets.
+namespace Loopback
+{
+// Listens on 127.0.0.1:Port, returns the socket or -1 if the port is
+// unavailable
+int Listen(uint16_t Port, int Backlog);
+
+// Waits for the next client, returns its socket or -1 once Running is
+// cleared
+int Accept(int Listener, const std::atomic<bool> &Running);
+
+// Waits until Socket has data or has closed, returns false once Running is
+// cleared
+bool WaitReadable(int Socket, const std::atomic<bool> &Running);
+
+void Close(int Socket);
+}
+}
@@ -0,0 +1,222 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Wunk8
+{
+// Lock-free metrics cheap enough to update every frame, rendered in the
+// Prometheus text exposition format.
+namespace Metrics
+{
+class Counter
+{
+public:
+	Counter()
+		:
+		Value(0)
+	{
+	}
+
+	void Add(uint64_t Amount = 1)
+	{
+		Value.fetch_add(Amount, std::memory_order_relaxed);
+	}
+
+	uint64_t Get() const
+	{
+		return Value.load(std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<uint64_t> Value;
+};
+
+class Gauge
+{
+public:
+	Gauge()
+		:
+		Bits(0)
+	{
+	}
+
+	void Set(double Value)
+	{
+		uint64_t NewBits;
+		memcpy(&NewBits, &Value, sizeof(double));
+		Bits.store(NewBits, std::memory_order_relaxed);
+	}
+
+	double Get() const
+	{
+		const uint64_t CurBits = Bits.load(std::memory_order_relaxed);
+		double Value;
+		memcpy(&Value, &CurBits, sizeof(double));
+		return Value;
+	}
+
+private:
+	std::atomic<uint64_t> Bits;
+};
+
+// Log-linear histogram in the style of HdrHistogram. Values below 32 are
+// exact and larger ones fall into one of 16 buckets per power of two,
+// keeping every recorded value within 6.25% of its bucket.
+class Histogram
+{
+public:
+	Histogram();
+
+	void Record(uint64_t Value)
+	{
+		Buckets[BucketIndex(Value)].fetch_add(1, std::memory_order_relaxed);
+		Count.fetch_add(1, std::memory_order_relaxed);
+		Sum.fetch_add(Value, std::memory_order_relaxed);
+		uint64_t CurMax = Max.load(std::memory_order_relaxed);
+		while(
+			Value > CurMax
+			&& !Max.compare_exchange_weak(CurMax, Value, std::memory_order_relaxed)
+		)
+		{
+		}
+	}
+
+	uint64_t GetCount() const
+	{
+		return Count.load(std::memory_order_relaxed);
+	}
+
+	uint64_t GetSum() const
+	{
+		return Sum.load(std::memory_order_relaxed);
+	}
+
+	uint64_t GetMax() const
+	{
+		return Max.load(std::memory_order_relaxed);
+	}
+
+	// Upper bound of the bucket holding the given quantile(0.0 to 1.0)
+	uint64_t GetQuantile(double Quantile) const;
+
+	// 32 exact values followed by 16 buckets for each power of two up to 2^63
+	static constexpr size_t BucketCount = 32 + 59 * 16;
+
+	static inline size_t BucketIndex(uint64_t Value)
+	{
+		if( Value < 32 )
+		{
+			return static_cast<size_t>(Value);
+		}
+		const size_t Magnitude = 63 - static_cast<size_t>(CountLeadingZeros(Value));
+		const size_t Top = static_cast<size_t>(Value >> (Magnitude - 4));
+		return 32 + (Magnitude - 5) * 16 + (Top - 16);
+	}
+
+	static uint64_t BucketUpperBound(size_t Index);
+
+private:
+	static inline unsigned CountLeadingZeros(uint64_t Value)
+	{
+#if defined(__GNUC__)
+		return static_cast<unsigned>(__builtin_clzll(Value));
+#else
+		unsigned Count = 0;
+		while( !(Value & (1ull << 63)) )
+		{
+			Value <<= 1;
+			Count++;
+		}
+		return Count;
+#endif
+	}
+
+	std::atomic<uint64_t> Buckets[BucketCount];
+	std::atomic<uint64_t> Count;
+	std::atomic<uint64_t> Sum;
+	std::atomic<uint64_t> Max;
+};
+
+// Named collection of metrics. Register everything before rendering or
+// exporting begins, after which updates and rendering may happen from any
+// thread.
+class Registry
+{
+public:
+	Counter& AddCounter(const std::string &Name, const std::string &Help);
+	Gauge& AddGauge(const std::string &Name, const std::string &Help);
+	// Rendered as a Prometheus summary with common quantiles
+	Histogram& AddHistogram(const std::string &Name, const std::string &Help);
+
+	// Prometheus text exposition format 0.0.4
+	std::string Render() const;
+
+private:
+	struct Entry
+	{
+		std::string Name;
+		std::string Help;
+		std::unique_ptr<Counter> AsCounter;
+		std::unique_ptr<Gauge> AsGauge;
+		std::unique_ptr<Histogram> AsHistogram;
+	};
+	std::vector<Entry> Entries;
+};
+
+// Serves Registry::Render over HTTP on a loopback port
+class Server
+{
+public:
+	explicit Server(const Registry &Source);
+	~Server();
+
+	Server(const Server&) = delete;
+	Server& operator=(const Server&) = delete;
+
+	// Listens on 127.0.0.1:Port, returns false if the port is unavailable
+	bool Start(uint16_t Port);
+	void Stop();
+
+private:
+	void Run();
+
+	const Registry &Source;
+	int Listener;
+	std::atomic<bool> Running;
+	std::thread Thread;
+};
+
+// Periodically rewrites a file with Registry::Render. Readers never see a
+// partially written file.
+class FileWriter
+{
+public:
+	FileWriter(const Registry &Source, const std::string &FileName);
+	~FileWriter();
+
+	FileWriter(const FileWriter&) = delete;
+	FileWriter& operator=(const FileWriter&) = delete;
+
+	void Start(std::chrono::milliseconds Interval);
+	void Stop();
+
+	// Writes the file immediately
+	bool WriteNow() const;
+
+private:
+	void Run(std::chrono::milliseconds Interval);
+
+	const Registry &Source;
+	std::string FileName;
+	std::atomic<bool> Running;
+	std::thread Thread;
+};
+}
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <ostream>
+
+namespace Wunk8
+{
+class Profiler;
+
+// Host hardware performance counters read around batches of Chip8::Tick
+// calls through Linux perf_event_open. Counters only cover user-space
+// execution of the calling thread. Unsupported events are skipped, and on
+// other platforms Open always fails.
+class PerfCounters
+{
+public:
+	enum Event
+	{
+		Instructions,
+		Cycles,
+		BranchMisses,
+		L1DMisses,
+		EventCount
+	};
+
+	struct Stats
+	{
+		// Emulated instructions executed within all batches
+		uint64_t Emulated;
+		uint64_t Counts[EventCount];
+		bool Valid[EventCount];
+
+		double PerInstruction(Event Type) const
+		{
+			return Emulated ? static_cast<double>(Counts[Type]) / Emulated : 0.0;
+		}
+	};
+
+	PerfCounters();
+	~PerfCounters();
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	// Returns false if no event could be opened
+	bool Open();
+	void Close();
+
+	bool IsOpen() const
+	{
+		return Leader >= 0;
+	}
+
+	// Brackets a batch of EmulatedInstructions Chip8::Tick calls
+	void Begin();
+	void End(uint64_t EmulatedInstructions);
+
+	void Reset();
+
+	Stats GetStats() const
+	{
+		return Totals;
+	}
+
+	static const char* EventName(Event Type);
+
+	// Human readable summary. With a profiler, the totals are also divided
+	// among opcode classes by their share of sampled time.
+	void WriteReport(std::ostream &Out, const Profiler *Prof = nullptr) const;
+
+private:
+	bool ReadCounters(uint64_t (&Values)[EventCount]);
+
+	int Leader;
+	int Descriptors[EventCount];
+	// Position of each event within a group read, if opened
+	int ReadIndex[EventCount];
+	size_t Opened;
+
+	uint64_t BatchStart[EventCount];
+	Stats Totals;
+};
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <ostream>
+#include <string>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+namespace Wunk8
+{
+// Per-instruction execution statistics gathered from within Chip8::Tick.
+//
+// The hooks in Chip8::Tick only exist when building with WUNK8_PROFILE
+// defined(the WUNK8_PROFILE CMake option), so this costs nothing otherwise.
+// Every instruction is counted, while timing is only taken for one
+// instruction out of every SampleInterval to keep the overhead low.
+class Profiler
+{
+public:
+	Profiler(uint32_t SampleInterval = 64);
+
+	void Reset();
+
+	// Hooks called by Chip8::Tick
+	inline void BeginInstruction(uint16_t PC, uint16_t Opcode)
+	{
+		CurClass = Opcode >> 12;
+		CurSubOp = SubOp(Opcode);
+		Counts[CurClass][CurSubOp]++;
+		PCHits[PC & 0xFFF]++;
+		if( --Countdown == 0 )
+		{
+			Sampling = true;
+			SampleStart = ReadTimestamp();
+		}
+	}
+
+	inline void EndInstruction()
+	{
+		if( Sampling )
+		{
+			SampledCycles[CurClass][CurSubOp] += ReadTimestamp() - SampleStart;
+			SampledCounts[CurClass][CurSubOp]++;
+			Sampling = false;
+			Countdown = SampleInterval;
+		}
+	}
+
+	inline void Sprite(uint8_t Height, bool Collision)
+	{
+		SpriteHeights[Height & 0xF]++;
+		SpriteCollisions[Height & 0xF] += Collision;
+	}
+
+	// Total executed instructions of an opcode class(upper nibble)
+	uint64_t GetClassCount(uint8_t Class) const;
+
+	// Estimated timestamp-counter cycles spent within an opcode class,
+	// extrapolated from the sampled instructions
+	double GetClassCycles(uint8_t Class) const;
+
+	// Structured dump of all statistics
+	void WriteJson(std::ostream &Out) const;
+
+	// One "Chip8;Class;SubOp Weight" line per executed sub-op, weighted by
+	// estimated cycles. Input to flamegraph.pl and compatible viewers.
+	void WriteFolded(std::ostream &Out) const;
+
+	// Second-level index used to tell instructions of a class apart
+	static inline uint8_t SubOp(uint16_t Opcode)
+	{
+		switch( Opcode >> 12 )
+		{
+		case 0x0:
+		case 0xE:
+		case 0xF:
+			return Opcode & 0xFF;
+		case 0x8:
+			return Opcode & 0xF;
+		}
+		return 0;
+	}
+
+	// Mnemonic of an opcode class, such as "DRW"
+	static const char* ClassName(uint8_t Class);
+	// Opcode pattern of a sub-op, such as "8XY4" or "FX33"
+	static std::string SubOpName(uint8_t Class, uint8_t SubOp);
+
+private:
+	static inline uint64_t ReadTimestamp()
+	{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return static_cast<uint64_t>(
+			std::chrono::steady_clock::now().time_since_epoch().count()
+		);
+#endif
+	}
+
+	double EstimatedCycles(uint8_t Class, uint8_t SubOp) const;
+
+	uint32_t SampleInterval;
+	uint32_t Countdown;
+	bool Sampling;
+	uint64_t SampleStart;
+	uint8_t CurClass;
+	uint8_t CurSubOp;
+
+	uint64_t Counts[16][256];
+	uint64_t SampledCounts[16][256];
+	uint64_t SampledCycles[16][256];
+	uint64_t PCHits[0x1000];
+	uint64_t SpriteHeights[16];
+	uint64_t SpriteCollisions[16];
+};
+}
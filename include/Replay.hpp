@@ -0,0 +1,28 @@
+#pragma once
+#include <stdint.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Wunk8
+{
+// Key input recorded by wunk8 --record-input, one "cycle key down|up" line
+// per event with the key in hexadecimal. Lines starting with # are comments.
+struct ReplayEvent
+{
+	// Instruction count at which the event takes effect
+	uint64_t Cycle;
+	// Keypad key, 0x0 to 0xF
+	uint8_t Key;
+	bool Pressed;
+};
+
+// Returns false for comments and malformed lines. Any state other than
+// down is a release.
+bool ParseReplayLine(const std::string &Line, ReplayEvent &Event);
+
+void WriteReplayLine(std::ostream &Stream, const ReplayEvent &Event);
+
+// Reads a whole recording, ordered by cycle
+bool ReadReplay(const std::string &FileName, std::vector<ReplayEvent> &Events);
+}
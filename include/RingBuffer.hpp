@@ -0,0 +1,93 @@
+#pragma once
+#include <atomic>
+#include <algorithm>
+#include <stddef.h>
+
+namespace Wunk8
+{
+// Fixed-size single-producer/single-consumer queue.
+// Push may only be called from one thread and Pop from one other thread.
+// Neither side ever blocks or allocates.
+template< typename T, size_t Capacity >
+class RingBuffer
+{
+	static_assert(
+		Capacity && (Capacity & (Capacity - 1)) == 0,
+		"Capacity must be a power of two"
+	);
+public:
+	RingBuffer()
+		:
+		Head(0),
+		Tail(0)
+	{
+	}
+
+	// Producer: returns the number of items that fit
+	size_t Push(const T *Items, size_t Count)
+	{
+		const size_t CurTail = Tail.load(std::memory_order_relaxed);
+		const size_t CurHead = Head.load(std::memory_order_acquire);
+		Count = std::min(Count, Capacity - (CurTail - CurHead));
+		for( size_t i = 0; i < Count; i++ )
+		{
+			Data[(CurTail + i) & (Capacity - 1)] = Items[i];
+		}
+		Tail.store(CurTail + Count, std::memory_order_release);
+		return Count;
+	}
+
+	bool Push(const T &Item)
+	{
+		return Push(&Item, 1) == 1;
+	}
+
+	// Consumer: returns the number of items read
+	size_t Pop(T *Items, size_t Count)
+	{
+		const size_t CurHead = Head.load(std::memory_order_relaxed);
+		const size_t CurTail = Tail.load(std::memory_order_acquire);
+		Count = std::min(Count, CurTail - CurHead);
+		for( size_t i = 0; i < Count; i++ )
+		{
+			Items[i] = Data[(CurHead + i) & (Capacity - 1)];
+		}
+		Head.store(CurHead + Count, std::memory_order_release);
+		return Count;
+	}
+
+	bool Pop(T &Item)
+	{
+		return Pop(&Item, 1) == 1;
+	}
+
+	// Consumer: oldest item without removing it, nullptr when empty
+	const T* Peek() const
+	{
+		const size_t CurHead = Head.load(std::memory_order_relaxed);
+		if( CurHead == Tail.load(std::memory_order_acquire) )
+		{
+			return nullptr;
+		}
+		return &Data[CurHead & (Capacity - 1)];
+	}
+
+	// Approximate when called concurrently with Push or Pop
+	size_t Size() const
+	{
+		return Tail.load(std::memory_order_acquire)
+			- Head.load(std::memory_order_acquire);
+	}
+
+	static constexpr size_t GetCapacity()
+	{
+		return Capacity;
+	}
+
+private:
+	// Both indices only ever increase and are masked upon access
+	alignas(64) std::atomic<size_t> Head;
+	alignas(64) std::atomic<size_t> Tail;
+	alignas(64) T Data[Capacity];
+};
+}
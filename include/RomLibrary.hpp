@@ -0,0 +1,112 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace Wunk8
+{
+class Chip8;
+
+// Read-only collection of Chip8 programs mapped into memory once and
+// indexed by a hash of their contents.
+//
+// A library can be opened from either:
+// - A directory of ROM files. An optional "manifest.txt" within the
+//   directory assigns metadata to files by name, one per line:
+//       <file name> <quirk profile> <speed>
+//   Lines starting with '#' are ignored.
+// - A pack file previously written by RomLibrary::WritePack
+class RomLibrary
+{
+public:
+	// Platform behavior a program was written against
+	enum class QuirkProfile : uint8_t
+	{
+		Chip8 = 0,
+		SuperChip = 1,
+		XOChip = 2
+	};
+
+	struct Metadata
+	{
+		QuirkProfile Quirks;
+		// Instructions to execute per 60hz frame
+		uint16_t Speed;
+	};
+
+	struct Entry
+	{
+		std::string Name;
+		uint64_t Hash;
+		// Points directly into the mapped file
+		const uint8_t *Data;
+		size_t Length;
+		Metadata Meta;
+	};
+
+	static constexpr uint16_t DefaultSpeed = 10;
+	static constexpr size_t MaxPackName = 44;
+
+	RomLibrary();
+	~RomLibrary();
+
+	RomLibrary(const RomLibrary&) = delete;
+	RomLibrary& operator=(const RomLibrary&) = delete;
+
+	// Maps a directory of ROM files or a pack file. Fails if a pack file
+	// is malformed or any program in it does not match its stored hash.
+	bool Open(const std::string &Path);
+
+	// Unmaps all files. All previously returned entries become invalid
+	void Close();
+
+	// Serializes all indexed programs and their metadata into a single
+	// pack file. Fails without writing anything if a name is longer than
+	// MaxPackName bytes.
+	bool WritePack(const std::string &FileName) const;
+
+	// Returns nullptr if no program is found
+	const Entry* Find(uint64_t Hash) const;
+	const Entry* Find(const std::string &Name) const;
+
+	const std::vector<Entry>& GetEntries() const
+	{
+		return Entries;
+	}
+
+	// Resets the console and copies the program from its mapped page
+	static bool Load(Chip8 &Console, const Entry &Rom);
+	bool Load(Chip8 &Console, uint64_t Hash) const;
+
+	// 64-bit FNV-1a hash of a program's contents
+	static uint64_t HashRom(const void *Data, size_t Length);
+
+	static const char* QuirkProfileName(QuirkProfile Profile);
+	static bool ParseQuirkProfile(const std::string &Name, QuirkProfile &Profile);
+
+private:
+	bool OpenDirectory(const std::string &Path);
+	bool OpenPack(const std::string &FileName);
+
+	// Maps an entire file read-only, returns nullptr on failure
+	const uint8_t* MapFile(const std::string &FileName, size_t &Length);
+
+	void AddEntry(Entry &&Rom);
+
+	struct Mapping
+	{
+		void *Base;
+		size_t Length;
+#if defined(_WIN32)
+		void *File;
+		void *Section;
+#endif
+	};
+
+	std::vector<Mapping> Mappings;
+	std::vector<Entry> Entries;
+	std::unordered_map<uint64_t, size_t> HashIndex;
+};
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <string>
+
+#include "Wunk8.hpp"
+
+namespace Wunk8
+{
+// Ring of recent frames in POSIX shared memory, written by one emulator and
+// read by any number of processes on the same host without copies through
+// the kernel.
+// Each slot is guarded by a sequence counter that is odd while the slot is
+// being written. Readers copy a slot out and retry if the counter changed
+// meanwhile, so the writer never waits on anyone.
+namespace SharedFrames
+{
+constexpr char Magic[8] = { 'W', '8', 'F', 'R', 'A', 'M', 'E', 'S' };
+constexpr uint32_t Version = 1;
+
+struct Slot
+{
+	std::atomic<uint64_t> Sequence;
+	// Counts every emulated frame from 0
+	uint64_t Frame;
+	uint64_t Cycles;
+	uint64_t StateHash;
+	// One byte per pixel, 0 or 1
+	uint8_t Screen[Chip8::Width * Chip8::Height];
+};
+
+struct Header
+{
+	char Magic[8];
+	uint32_t Version;
+	uint32_t SlotCount;
+	uint32_t Width;
+	uint32_t Height;
+	// Frame number of the newest complete frame plus one, 0 before the first
+	std::atomic<uint64_t> Published;
+	// Slots follow
+};
+
+// Bytes of shared memory for a ring of SlotCount slots
+size_t GetSize(uint32_t SlotCount);
+
+// A copy of one published frame
+struct CopiedFrame
+{
+	uint64_t Frame;
+	uint64_t Cycles;
+	uint64_t StateHash;
+	uint8_t Screen[Chip8::Width * Chip8::Height];
+};
+
+class Writer
+{
+public:
+	Writer();
+	~Writer();
+
+	// Creates or replaces the shared memory object Name, such as "/wunk8"
+	bool Open(const std::string &Name, uint32_t SlotCount = 64);
+
+	bool IsOpen() const
+	{
+		return Ring != nullptr;
+	}
+
+	// Publishes the console's current screen as the next frame
+	void Publish(const Chip8 &Console);
+
+private:
+	void Close();
+
+	std::string Name;
+	Header *Ring;
+	size_t Size;
+	uint64_t NextFrame;
+};
+
+class Reader
+{
+public:
+	Reader();
+	~Reader();
+
+	bool Open(const std::string &Name);
+
+	// Frame number of the newest frame plus one, 0 before the first
+	uint64_t GetPublished() const;
+
+	// Copies out frame Number, returning false if it was not published yet,
+	// was already overwritten, or its slot stayed mid-write as when the
+	// writer died while publishing it
+	bool Read(uint64_t Number, CopiedFrame &Result) const;
+
+private:
+	void Close();
+
+	const Header *Ring;
+	size_t Size;
+};
+}
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+
+namespace Wunk8
+{
+// Fixed-capacity set of 64-bit state hashes that any number of threads may
+// insert into concurrently without locking.
+// Open addressing with linear probing, where a slot is claimed with a single
+// compare-exchange. Entries are never removed.
+class StateSet
+{
+public:
+	// Capacity is rounded up to a power of two
+	explicit StateSet(size_t Capacity)
+		:
+		Mask(RoundUp(Capacity) - 1),
+		Slots(new std::atomic<uint64_t>[Mask + 1]),
+		Count(0)
+	{
+		for( size_t i = 0; i <= Mask; i++ )
+		{
+			Slots[i].store(Empty, std::memory_order_relaxed);
+		}
+	}
+
+	enum class Result
+	{
+		Inserted,
+		Present,
+		Full
+	};
+
+	Result Insert(uint64_t Hash)
+	{
+		// Zero marks empty slots, so it shares a slot with one
+		Hash = Hash == Empty ? 1 : Hash;
+		size_t Index = static_cast<size_t>(Hash ^ (Hash >> 29)) & Mask;
+		for( size_t Probe = 0; Probe <= Mask; Probe++ )
+		{
+			uint64_t Current = Slots[Index].load(std::memory_order_relaxed);
+			if( Current == Empty )
+			{
+				if(
+					Slots[Index].compare_exchange_strong(
+						Current, Hash, std::memory_order_relaxed
+					)
+				)
+				{
+					Count.fetch_add(1, std::memory_order_relaxed);
+					return Result::Inserted;
+				}
+				// Lost the race for this slot, Current now holds the winner
+			}
+			if( Current == Hash )
+			{
+				return Result::Present;
+			}
+			Index = (Index + 1) & Mask;
+		}
+		return Result::Full;
+	}
+
+	bool Contains(uint64_t Hash) const
+	{
+		Hash = Hash == Empty ? 1 : Hash;
+		size_t Index = static_cast<size_t>(Hash ^ (Hash >> 29)) & Mask;
+		for( size_t Probe = 0; Probe <= Mask; Probe++ )
+		{
+			const uint64_t Current = Slots[Index].load(std::memory_order_relaxed);
+			if( Current == Hash )
+			{
+				return true;
+			}
+			if( Current == Empty )
+			{
+				return false;
+			}
+			Index = (Index + 1) & Mask;
+		}
+		return false;
+	}
+
+	size_t Size() const
+	{
+		return Count.load(std::memory_order_relaxed);
+	}
+
+	size_t GetCapacity() const
+	{
+		return Mask + 1;
+	}
+
+private:
+	static constexpr uint64_t Empty = 0;
+
+	static size_t RoundUp(size_t Value)
+	{
+		size_t Result = 1;
+		while( Result < Value )
+		{
+			Result <<= 1;
+		}
+		return Result;
+	}
+
+	const size_t Mask;
+	std::unique_ptr<std::atomic<uint64_t>[]> Slots;
+	std::atomic<size_t> Count;
+};
+}
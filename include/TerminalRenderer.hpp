@@ -0,0 +1,63 @@
+#pragma once
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace Wunk8
+{
+// Draws the Chip8 display into an ANSI terminal using unicode block
+// characters. Only the cells that changed since the previous frame are
+// emitted, and each frame is sent with a single write.
+class TerminalRenderer
+{
+public:
+	enum class Mode
+	{
+		// 1x2 pixels per cell, 64x16 cells
+		HalfBlock,
+		// 2x4 pixels per cell, 32x8 cells
+		Braille
+	};
+
+	// FileDescriptor is the POSIX file descriptor frames are written to
+	TerminalRenderer(Mode CellMode, int FileDescriptor = 1);
+	~TerminalRenderer();
+
+	TerminalRenderer(const TerminalRenderer&) = delete;
+	TerminalRenderer& operator=(const TerminalRenderer&) = delete;
+
+	// Screen is the Chip8 display at one byte per pixel
+	void Draw(const uint8_t *Screen);
+
+	// Redraws every cell upon the next frame, such as after the terminal
+	// was cleared or resized
+	void Invalidate()
+	{
+		FullRedraw = true;
+	}
+
+	// Size in bytes of the last emitted frame
+	size_t GetLastFrameSize() const
+	{
+		return LastFrameSize;
+	}
+
+private:
+	uint8_t CellBits(const uint8_t *Screen, size_t CellX, size_t CellY) const;
+	void AppendGlyph(uint8_t Bits);
+	void Flush();
+
+	Mode CellMode;
+	int FileDescriptor;
+	size_t CellsWide;
+	size_t CellsHigh;
+
+	// Pixel bits of each cell as of the last frame
+	uint8_t Cells[64 * 16];
+	bool FullRedraw;
+
+	// Reused between frames to avoid allocations
+	std::string Output;
+	size_t LastFrameSize;
+};
+}
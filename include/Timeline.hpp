@@ -0,0 +1,91 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+namespace Wunk8
+{
+// Host-side timeline of named phases, written in the Chrome trace-event
+// JSON format that chrome://tracing and ui.perfetto.dev open.
+//
+// Each thread appends into its own fixed-size buffer without locking, so
+// recording an event costs two clock reads and a store. Recording is off
+// until Start is called, in which case each event costs a single load.
+namespace Timeline
+{
+// Events per thread, further events are dropped and counted
+constexpr size_t ThreadCapacity = 1 << 18;
+
+struct Event
+{
+	// Must point to a string that outlives the timeline, usually a literal
+	const char *Name;
+	// Nanoseconds since Start
+	uint64_t Begin;
+	uint64_t Duration;
+};
+
+void Start();
+void Stop();
+
+// Use IsEnabled
+extern std::atomic<bool> Enabled;
+
+inline bool IsEnabled()
+{
+	return Enabled.load(std::memory_order_relaxed);
+}
+
+// Nanoseconds since Start
+uint64_t Now();
+
+// Appends a complete event to the calling thread's buffer
+void Record(const char *Name, uint64_t Begin, uint64_t End);
+
+// Names the calling thread within the written timeline
+void SetThreadName(const char *Name);
+
+// Writes all recorded events. Events still being recorded concurrently may
+// or may not be included.
+bool Write(const std::string &FileName);
+
+// Events dropped because a thread's buffer was full
+uint64_t GetDropped();
+
+// Records the lifetime of the enclosing scope
+class ScopedEvent
+{
+public:
+	explicit ScopedEvent(const char *Name)
+		:
+		Name(Name),
+		Active(IsEnabled()),
+		Begin(Active ? Now() : 0)
+	{
+	}
+
+	~ScopedEvent()
+	{
+		if( Active )
+		{
+			Record(Name, Begin, Now());
+		}
+	}
+
+	ScopedEvent(const ScopedEvent&) = delete;
+	ScopedEvent& operator=(const ScopedEvent&) = delete;
+
+private:
+	const char *Name;
+	const bool Active;
+	uint64_t Begin;
+};
+}
+}
+
+#define WUNK8_TIMELINE_CONCAT2(A, B) A##B
+#define WUNK8_TIMELINE_CONCAT(A, B) WUNK8_TIMELINE_CONCAT2(A, B)
+#define WUNK8_TIMELINE_SCOPE(Name) \
+	const Wunk8::Timeline::ScopedEvent WUNK8_TIMELINE_CONCAT(TimelineScope, __LINE__)(Name)
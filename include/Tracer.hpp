@@ -0,0 +1,128 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <memory>
+
+namespace Wunk8
+{
+// One executed instruction
+struct TraceRecord
+{
+	// Instructions executed before this one since reset
+	uint64_t Cycle;
+	uint16_t PC;
+	uint16_t Opcode;
+	// Index register after execution
+	uint16_t I;
+	// Lowest general register the instruction changed, NoRegister if none
+	uint8_t Register;
+	// Value of that register after execution
+	uint8_t Value;
+};
+static_assert(sizeof(TraceRecord) == 16, "TraceRecord must stay 16 bytes");
+
+// Trace file layout:
+// TraceHeader
+// TraceRecord[Count], oldest first
+struct TraceHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint32_t RecordSize;
+	uint32_t Count;
+};
+
+// Keeps the most recent instructions in a fixed-size in-memory ring.
+//
+// The hooks in Chip8::Tick only exist when building with WUNK8_TRACE
+// defined(the WUNK8_TRACE CMake option), so this costs nothing otherwise.
+class Tracer
+{
+public:
+	static constexpr char Magic[4] = { 'W', '8', 'T', 'R' };
+	static constexpr uint32_t Version = 1;
+	static constexpr uint8_t NoRegister = 0xFF;
+
+	// Capacity is rounded up to a power of two
+	explicit Tracer(size_t Capacity = 1 << 16);
+	~Tracer();
+
+	Tracer(const Tracer&) = delete;
+	Tracer& operator=(const Tracer&) = delete;
+
+	// Hook called by Chip8::Tick
+	inline void Record(
+		uint64_t Cycle, uint16_t PC, uint16_t Opcode, uint16_t I,
+		const uint8_t (&OldV)[16], const uint8_t (&NewV)[16]
+	)
+	{
+		TraceRecord &Cur = Records[Written++ & Mask];
+		Cur.Cycle = Cycle;
+		Cur.PC = PC;
+		Cur.Opcode = Opcode;
+		Cur.I = I;
+		Cur.Register = NoRegister;
+		Cur.Value = 0;
+		// Compare the register file eight registers at a time
+		for( size_t i = 0; i < 16; i += 8 )
+		{
+			uint64_t Old, New;
+			memcpy(&Old, &OldV[i], sizeof(uint64_t));
+			memcpy(&New, &NewV[i], sizeof(uint64_t));
+			if( const uint64_t Changed = Old ^ New )
+			{
+				// Little-endian: the lowest set byte is the lowest register
+				const uint8_t Index = static_cast<uint8_t>(i + LowestByte(Changed));
+				Cur.Register = Index;
+				Cur.Value = NewV[Index];
+				break;
+			}
+		}
+	}
+
+	void Clear()
+	{
+		Written = 0;
+	}
+
+	// Records currently held, at most the capacity
+	size_t GetCount() const
+	{
+		return Written < Capacity ? static_cast<size_t>(Written) : Capacity;
+	}
+
+	// Writes the held records to a file, oldest first
+	bool Flush(const char *FileName) const;
+
+	// Flushes this tracer to FileName if the process crashes with SIGSEGV,
+	// SIGBUS, SIGILL, SIGFPE or SIGABRT. Only one tracer may be installed.
+	void InstallCrashHandler(const char *FileName);
+	static void RemoveCrashHandler();
+
+private:
+	static inline size_t LowestByte(uint64_t Value)
+	{
+#if defined(__GNUC__)
+		return static_cast<size_t>(__builtin_ctzll(Value)) / 8;
+#else
+		size_t Index = 0;
+		while( !(Value & 0xFF) )
+		{
+			Value >>= 8;
+			Index++;
+		}
+		return Index;
+#endif
+	}
+
+	// Only uses async-signal-safe calls
+	bool WriteFile(const char *FileName) const;
+	static void OnCrash(int Signal);
+
+	size_t Capacity;
+	size_t Mask;
+	uint64_t Written;
+	std::unique_ptr<TraceRecord[]> Records;
+};
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <chrono>
+#include <vector>
+
+#include "Wunk8.hpp"
+
+namespace Wunk8
+{
+// Memoizes runs of instructions that never looked at the keyboard.
+// A run is keyed by the state hash it started from along with where in the
+// frame it started and how many instructions it covered. When a known state
+// recurs, the stored result is copied in instead of executing again. Runs
+// that read the keyboard depend on more than the state hash and are never
+// stored.
+// Entries are direct-mapped, so a newer run evicts an older one sharing its
+// slot. Not thread-safe, use one cache per thread.
+// Skipped instructions are not seen by an attached profiler or tracer.
+class TransitionCache
+{
+public:
+	// Capacity is rounded up to a power of two. Each entry holds a complete
+	// machine state of a few kilobytes.
+	TransitionCache(
+		size_t Capacity,
+		uint32_t InstructionsPerFrame,
+		std::chrono::microseconds FramePeriod = DefaultFramePeriod
+	);
+
+	// Runs Count instructions, the first of them at instruction Slot of the
+	// frame, spreading the frame period over the frame as the frontend does
+	bool Run(Chip8 &Console, uint32_t Slot, uint32_t Count);
+
+	struct Stats
+	{
+		// Runs copied from the cache
+		uint64_t Hits;
+		// Runs executed and stored
+		uint64_t Misses;
+		// Runs executed but not stored because they read the keyboard
+		uint64_t Bypassed;
+		// Instructions not executed thanks to hits
+		uint64_t Skipped;
+	};
+
+	const Stats& GetStats() const
+	{
+		return Counters;
+	}
+
+	void Clear();
+
+private:
+	struct Entry
+	{
+		// Zero while unused
+		uint64_t Key;
+		bool Drew;
+		Chip8 After;
+	};
+
+	uint64_t GetKey(const Chip8 &Console, uint32_t Slot, uint32_t Count) const;
+
+	const uint32_t InstructionsPerFrame;
+	const std::chrono::microseconds FramePeriod;
+	std::vector<Entry> Entries;
+	size_t Mask;
+	Stats Counters;
+};
+}
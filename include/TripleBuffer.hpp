@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <stdint.h>
+
+namespace Wunk8
+{
+// Hands the latest of a stream of values from one producer thread to one
+// consumer thread.
+// The producer fills its back buffer and publishes it, the consumer picks up
+// whichever buffer was published last. Neither side ever blocks or waits on
+// the other and intermediate values the consumer did not get to are skipped.
+template< typename T >
+class TripleBuffer
+{
+public:
+	TripleBuffer()
+		:
+		Middle(1),
+		Back(0),
+		Front(2)
+	{
+	}
+
+	// Producer: buffer to fill before publishing. Holds stale contents from
+	// an earlier value.
+	T& GetBackBuffer()
+	{
+		return Buffers[Back];
+	}
+
+	// Producer: makes the back buffer the latest value
+	void Publish()
+	{
+		Back = Middle.exchange(Back | FreshBit, std::memory_order_acq_rel) & IndexMask;
+	}
+
+	// Consumer: picks up the latest value if one was published since the
+	// last call, returns false otherwise
+	bool Update()
+	{
+		if( !(Middle.load(std::memory_order_relaxed) & FreshBit) )
+		{
+			return false;
+		}
+		Front = Middle.exchange(Front, std::memory_order_acq_rel) & IndexMask;
+		return true;
+	}
+
+	// Consumer: latest value picked up by Update
+	const T& GetFrontBuffer() const
+	{
+		return Buffers[Front];
+	}
+
+private:
+	static constexpr uint8_t IndexMask = 0x3;
+	static constexpr uint8_t FreshBit = 0x4;
+
+	// Index of the buffer between the two threads, along with whether it
+	// was published since the consumer last took it
+	std::atomic<uint8_t> Middle;
+	// Owned by the producer
+	uint8_t Back;
+	// Owned by the consumer
+	uint8_t Front;
+	T Buffers[3];
+};
+}
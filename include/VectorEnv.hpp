@@ -0,0 +1,78 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#include "Wunk8.hpp"
+
+namespace Wunk8
+{
+// Steps many consoles running the same program with a single call, for
+// agents that act on batches of environments.
+// Every console holds its action for a number of frames and then writes its
+// observation into one contiguous array owned by the caller. Nothing is
+// allocated once the observation is configured.
+class VectorEnv
+{
+public:
+	// Console i is seeded with Seed + i
+	VectorEnv(size_t Count, uint32_t InstructionsPerFrame, uint32_t Seed = 0);
+
+	// Loads the program into every console and makes the result the state
+	// that Reset returns to
+	bool LoadGame(const void *Data, size_t Length);
+
+	// Returns console Index, or all of them, to the state after LoadGame
+	void Reset(size_t Index);
+	void ResetAll();
+
+	// Observations are the screen packed to 1 bit per pixel, most
+	// significant bit leftmost, 8 bytes per row
+	void ObserveScreen();
+	// Observations are the bytes at the given addresses, in order
+	void ObserveMemory(const uint16_t *Addresses, size_t Count);
+
+	// Bytes of observation written per console
+	size_t GetObservationSize() const
+	{
+		return ObservationSize;
+	}
+
+	// Sets each console's keypad to Keys[i], one bit per key, runs it for
+	// Frames[i] frames and writes its observation to
+	// Observations + i * GetObservationSize().
+	// Null Keys leaves the keypads alone, null Frames runs one frame and
+	// null Observations skips writing them.
+	void Step(const uint16_t *Keys, const uint32_t *Frames, uint8_t *Observations);
+
+	// Writes observations without running anything
+	void Observe(uint8_t *Observations) const;
+
+	size_t GetCount() const
+	{
+		return Consoles.size();
+	}
+
+	Chip8& GetConsole(size_t Index)
+	{
+		return Consoles[Index];
+	}
+	const Chip8& GetConsole(size_t Index) const
+	{
+		return Consoles[Index];
+	}
+
+	static constexpr size_t ScreenObservationSize = Chip8::Width * Chip8::Height / 8;
+
+private:
+	void Observe(size_t Index, uint8_t *Observation) const;
+
+	const uint32_t InstructionsPerFrame;
+	std::vector<Chip8> Consoles;
+	// States that Reset copies back
+	std::vector<Chip8> Initial;
+	// Empty when observing the screen
+	std::vector<uint16_t> Addresses;
+	size_t ObservationSize;
+};
+}
@@ -1,28 +1,81 @@
 #pragma once
 #include <string>
 #include <stdint.h>
+#include <algorithm>
 #include <chrono>
-#include <random>
+
+#if defined(WUNK8_PROFILE)
+#include "Profiler.hpp"
+#endif
+
+#if defined(WUNK8_TRACE)
+#include "Tracer.hpp"
+#endif
 
 namespace Wunk8
 {
+// Mulberry32, small enough to keep snapshots cheap unlike std::mt19937 and
+// usable in constant expressions
+struct Mulberry32
+{
+	uint32_t State;
+
+	constexpr uint8_t Next()
+	{
+		uint32_t Value = State += 0x6D2B79F5;
+		Value = (Value ^ (Value >> 15)) * (Value | 1);
+		Value ^= Value + (Value ^ (Value >> 7)) * (Value | 61);
+		return static_cast<uint8_t>((Value ^ (Value >> 14)) >> 24);
+	}
+};
+
+// Emulated length of a frame, the 60Hz of the timers rounded the way every
+// frontend and tool paces them
+constexpr std::chrono::microseconds DefaultFramePeriod(16000);
+
+// Emulated time given to instruction Slot of a frame, spreading FramePeriod
+// over InstructionsPerFrame instructions without losing the remainder
+constexpr std::chrono::microseconds GetTickTime(
+	uint32_t Slot, uint32_t InstructionsPerFrame,
+	std::chrono::microseconds FramePeriod = DefaultFramePeriod
+)
+{
+	return FramePeriod * (Slot + 1) / InstructionsPerFrame
+		- FramePeriod * Slot / InstructionsPerFrame;
+}
+
+class Chip8;
+constexpr Chip8 BootImage(
+	const uint8_t *Program, size_t Length, uint64_t Instructions,
+	uint32_t InstructionsPerFrame, uint32_t Seed
+);
+
+// Construction, Reset, loading from memory and running instructions are
+// constexpr, so a machine can be booted entirely at compile time. See
+// BootImage.
 class Chip8
 {
+	friend class TransitionCache;
+	friend constexpr Chip8 BootImage(
+		const uint8_t *Program, size_t Length, uint64_t Instructions,
+		uint32_t InstructionsPerFrame, uint32_t Seed
+	);
+
 public:
-	Chip8(uint32_t Seed = 0);
-	~Chip8();
+	constexpr Chip8(uint32_t Seed = 0);
 
 	// Sets a default Chip8 Processor state
-	void Reset();
+	constexpr void Reset();
 
 	// Loads a Chip8 Program from a file
 	bool LoadGame(const std::string &FileName);
 
 	// Loads a Chip8 Program from memory
 	bool LoadGame(const void *Data, size_t Length);
+	constexpr bool LoadGame(const uint8_t *Data, size_t Length);
 
-	// Simulates complete cycles for the designated amount of time
-	bool Tick(const std::chrono::milliseconds DeltaTime);
+	// Simulates one instruction followed by the designated amount of time
+	bool Tick(const std::chrono::microseconds DeltaTime);
 
 	// Input
 	inline void KeyDown(uint16_t Key)
@@ -33,6 +86,11 @@ public:
 	{
 		Keyboard.KeyStates &= ~(Key);
 	}
+	// Bit n set while key n is held
+	uint16_t GetKeys() const
+	{
+		return Keyboard.KeyStates;
+	}
 
 	// Gets Current Screen
 	const uint8_t* GetScreen() const
@@ -40,9 +98,102 @@ public:
 		return &Display.Screen[0];
 	};
 
+	// Gets the 4KB address space
+	const uint8_t* GetMemory() const
+	{
+		return &Memory.Data[0];
+	}
+
 	static constexpr size_t Width = 64;
 	static constexpr size_t Height = 32;
 
+	// Instructions executed since the last reset
+	constexpr uint64_t GetCycles() const
+	{
+		return Cycles;
+	}
+
+	// Address of the next instruction
+	constexpr uint16_t GetPC() const
+	{
+		return Registers.PC;
+	}
+
+	// Sound
+	// A tone plays for as long as the sound timer is non-zero
+	bool IsSoundActive() const
+	{
+		return Timer.Sound != 0;
+	}
+
+	// XO-CHIP 1-bit audio pattern, only used once a program loads one
+	bool HasAudioPattern() const
+	{
+		return Audio.PatternLoaded;
+	}
+	const uint8_t* GetAudioPattern() const
+	{
+		return &Audio.Pattern[0];
+	}
+	uint8_t GetAudioPitch() const
+	{
+		return Audio.Pitch;
+	}
+
+#if defined(WUNK8_PROFILE)
+	// Attaches an instruction profiler, nullptr to detach
+	void SetProfiler(Profiler *NewProfiler)
+	{
+		Prof = NewProfiler;
+	}
+#endif
+
+#if defined(WUNK8_TRACE)
+	// Attaches an execution tracer, nullptr to detach
+	void SetTracer(Tracer *NewTracer)
+	{
+		Trace = NewTracer;
+	}
+#endif
+
+	// Hashing
+	// Memory and screen hashes are updated on every write, so neither is
+	// ever rehashed in full. Equal states always hash equally.
+	constexpr uint64_t GetScreenHash() const
+	{
+		return Hash.Screen;
+	}
+	constexpr uint64_t GetMemoryHash() const
+	{
+		return Hash.Memory;
+	}
+
+	// Combines the memory and screen hashes with a hash of the registers,
+	// stack, timers, random and audio state taken on demand. Covers
+	// everything that determines future execution except the keyboard.
+	uint64_t GetStateHash() const;
+
+	// Rehashes everything from scratch, for checking the incremental hashes
+	uint64_t ComputeScreenHash() const;
+	uint64_t ComputeStateHash() const;
+
+	// Compares all architectural state along with the cycle count, frame
+	// flag and incremental hashes. Returns the name of the first part that
+	// differs, nullptr if none does.
+	const char* FindDifference(const Chip8 &Other) const;
+
+	// Snapshots
+	// All machine state is plain data, so a copy of a Chip8 is a snapshot
+	// costing a single memcpy of a few kilobytes.
+	// Restores a snapshot, keeping the profiler and tracer attached to this
+	// instance
+	void LoadState(const Chip8 &Snapshot);
+
+	// Writes or reads the machine state as a file, which is only valid for
+	// the same build
+	bool SaveStateFile(const std::string &FileName) const;
+	bool LoadStateFile(const std::string &FileName);
+
 	bool QueryFrame()
 	{
 		if( DeltaFrame )
@@ -54,20 +205,50 @@ public:
 	}
 
 private:
+	// Tick itself, kept inline for BootImage. Everything else calls the one
+	// out of line Tick so the profile guided build trains the copy that runs.
+	constexpr bool Execute(const std::chrono::microseconds DeltaTime);
+
 	// Seed used for random number generation
 	uint32_t Seed;
-	std::mt19937 RandEng;
+	Mulberry32 Random;
+
+	constexpr void WriteMemory(uint16_t Address, uint8_t Value);
+	constexpr uint64_t ComputeMemoryHash() const;
+	static constexpr uint64_t ComputePowerOnMemoryHash();
+	struct PowerOn;
+	uint64_t HashRegisters() const;
+
+	// Zobrist keys of each part of the machine
+	static constexpr uint64_t ZobristKey(uint64_t Key);
+	static constexpr uint64_t MemoryKey(size_t Address, uint8_t Value);
+	static constexpr uint64_t PixelKey(size_t Index);
+	static constexpr uint64_t RegisterKey(size_t Index, uint32_t Value);
 
 	bool DeltaFrame;
 
+	// Set by any instruction that looks at the keyboard, cleared by whoever
+	// needs to know whether the keyboard influenced execution
+	bool KeyRead;
+
+	uint64_t Cycles;
+
+#if defined(WUNK8_PROFILE)
+	Profiler *Prof;
+#endif
+
+#if defined(WUNK8_TRACE)
+	Tracer *Trace;
+#endif
+
 	// RAM/ROM space:
-	// 0xFFF(4096) bytes of Total Ram
+	// 0x1000(4096) bytes of Total Ram
 	// 0x000 to 0x1FF(512 bytes)	: Reserved for Interpretor
 	// 0x200 						: Start of most Chip-8 Programs
 	// 0x600						: Start of ETI 660 Chip-8 programs
 	struct
 	{
-		uint8_t Data[0xFFF];
+		uint8_t Data[0x1000];
 	} Memory;
 
 	struct
@@ -97,7 +278,7 @@ private:
 	uint16_t Stack[16];
 
 	// Keyboard
-	// Array of 16 binary flags for each key
+	// Array of 16 binary flags for each key, bit n holding key n
 	// Keypad layout:
 	// 1 2 3 C
 	// 4 5 6 D
@@ -109,10 +290,10 @@ private:
 		struct
 		{
 			bool
-				Key1 : 1, Key2 : 1, Key3 : 1, KeyC : 1,
-				Key4 : 1, Key5 : 1, Key6 : 1, KeyD : 1,
-				Key7 : 1, Key8 : 1, Key9 : 1, KeyE : 1,
-				KeyA : 1, Key0 : 1, KeyB : 1, KeyF : 1;
+				Key0 : 1, Key1 : 1, Key2 : 1, Key3 : 1,
+				Key4 : 1, Key5 : 1, Key6 : 1, Key7 : 1,
+				Key8 : 1, Key9 : 1, KeyA : 1, KeyB : 1,
+				KeyC : 1, KeyD : 1, KeyE : 1, KeyF : 1;
 		};
 	} Keyboard;
 
@@ -141,12 +322,585 @@ private:
 		// rate of 60 hz.
 		uint8_t Delay;
 		// Sound Timer decrements by 1 at a
-		// rate of 60 hz. A sound is to play
-		// when 0 is reached.
+		// rate of 60 hz. A sound plays for as
+		// long as it is non-zero.
 		uint8_t Sound;
+		// Microseconds elapsed since the last
+		// decrement
+		uint32_t Elapsed;
 	} Timer;
 
+	// Audio:
+	// XO-CHIP extension. F002 loads a 128-bit
+	// pattern from I and FX3A sets its playback
+	// rate to 4000*2^((VX-64)/48) bits per second.
+	struct
+	{
+		uint8_t Pattern[16];
+		uint8_t Pitch;
+		bool PatternLoaded;
+	} Audio;
+
+	// Zobrist-style hashes, XOR-ing in a key for each byte of memory and
+	// each lit pixel
+	struct
+	{
+		uint64_t Memory;
+		uint64_t Screen;
+	} Hash;
+
 	// 16 ms per tick
 	static constexpr size_t TimerRate = 16;
+
+	static constexpr uint8_t Font[16 * 5] =
+	{
+		0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+		0x20, 0x60, 0x20, 0x20, 0x70, // 1
+		0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+		0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+		0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+		0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+		0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+		0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+		0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+		0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+		0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+		0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+		0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+		0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+		0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+		0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+	};
 };
+
+// Resets, loads Length bytes of Program and runs Instructions instructions
+// with no keys held, spreading 16ms frames over InstructionsPerFrame
+// instructions as the frontend does. As a constexpr variable the resulting
+// machine is baked into read-only data, so start-up code that always does
+// the same thing runs once at compile time and each instance is a copy:
+//
+//	static constexpr uint8_t Program[] = { 0x00, 0xE0, ... };
+//	static constexpr Chip8 Booted = BootImage(Program, sizeof(Program), 500);
+//	Chip8 Console = Booted;
+//
+// Instructions is bounded by the compiler's constexpr loop and operation
+// limits.
+constexpr Chip8 BootImage(
+	const uint8_t *Program, size_t Length, uint64_t Instructions = 0,
+	uint32_t InstructionsPerFrame = 10, uint32_t Seed = 0
+);
+
+// SplitMix64 finalizer, standing in for a table of random Zobrist keys which
+// would be 8MB for all 4096 * 256 memory values
+constexpr uint64_t Chip8::ZobristKey(uint64_t Key)
+{
+	Key += 0x9E3779B97F4A7C15ull;
+	Key = (Key ^ (Key >> 30)) * 0xBF58476D1CE4E5B9ull;
+	Key = (Key ^ (Key >> 27)) * 0x94D049BB133111EBull;
+	return Key ^ (Key >> 31);
+}
+
+// Separate key ranges for each part of the machine
+constexpr uint64_t Chip8::MemoryKey(size_t Address, uint8_t Value)
+{
+	return ZobristKey((static_cast<uint64_t>(Address) << 8) | Value);
+}
+
+constexpr uint64_t Chip8::PixelKey(size_t Index)
+{
+	return ZobristKey(0x100000 | Index);
+}
+
+constexpr uint64_t Chip8::RegisterKey(size_t Index, uint32_t Value)
+{
+	return ZobristKey((static_cast<uint64_t>(0x200 | Index) << 32) | Value);
+}
+
+// Hash of the memory Reset leaves behind, the font followed by zeros
+constexpr uint64_t Chip8::ComputePowerOnMemoryHash()
+{
+	uint64_t Result = 0;
+	for( size_t i = 0; i < sizeof(Memory.Data); i++ )
+	{
+		Result ^= MemoryKey(i, i < sizeof(Font) ? Font[i] : 0);
+	}
+	return Result;
+}
+
+// Evaluated once by the compiler rather than on every Reset
+struct Chip8::PowerOn
+{
+	static constexpr uint64_t MemoryHash = ComputePowerOnMemoryHash();
+};
+
+constexpr Chip8::Chip8(uint32_t Seed)
+	:
+	Seed(Seed),
+	Random{ Seed },
+	DeltaFrame(false),
+	KeyRead(false),
+	Cycles(0),
+#if defined(WUNK8_PROFILE)
+	Prof(nullptr),
+#endif
+#if defined(WUNK8_TRACE)
+	Trace(nullptr),
+#endif
+	// Constant evaluation needs every member initialized before Reset
+	Memory{},
+	Registers{},
+	Stack{},
+	Keyboard{},
+	Display{},
+	Timer{},
+	Audio{},
+	Hash{}
+{
+	Reset();
+}
+
+constexpr void Chip8::Reset()
+{
+	// Ram/Rom
+	for( size_t i = 0; i < sizeof(Memory.Data); i++ )
+	{
+		Memory.Data[i] = 0;
+	}
+
+	// Load FontSet into memory
+	for( size_t i = 0; i < sizeof(Font); i++ )
+	{
+		Memory.Data[i] = Font[i];
+	}
+
+	// Registers
+	// Program counter starts at 0x200
+	for( size_t i = 0; i < 16; i++ )
+	{
+		Registers.V[i] = 0;
+	}
+	Registers.I = 0;
+	Registers.PC = 0x200;
+	Registers.SP = 0;
+
+	// Stack
+	for( size_t i = 0; i < 16; i++ )
+	{
+		Stack[i] = 0;
+	}
+
+	// Display
+	for( size_t i = 0; i < sizeof(Display.Screen); i++ )
+	{
+		Display.Screen[i] = 0;
+	}
+
+	Random.State = Seed;
+
+	Hash.Memory = PowerOn::MemoryHash;
+	Hash.Screen = 0;
+
+	Timer.Delay = Timer.Sound = 0;
+	Timer.Elapsed = 0;
+	DeltaFrame = false;
+	KeyRead = false;
+	Cycles = 0;
+	Keyboard.KeyStates = 0;
+
+	// Audio
+	for( size_t i = 0; i < sizeof(Audio.Pattern); i++ )
+	{
+		Audio.Pattern[i] = 0;
+	}
+	Audio.Pitch = 64;
+	Audio.PatternLoaded = false;
+}
+
+constexpr bool Chip8::LoadGame(const uint8_t *Data, size_t Length)
+{
+	if( Data )
+	{
+		// Updates the hash for only the bytes written
+		Length = std::min(sizeof(Memory.Data) - 0x200, Length);
+		for( size_t i = 0; i < Length; i++ )
+		{
+			WriteMemory(static_cast<uint16_t>(0x200 + i), Data[i]);
+		}
+	}
+	return true;
+}
+
+constexpr void Chip8::WriteMemory(uint16_t Address, uint8_t Value)
+{
+	Address &= 0xFFF;
+	Hash.Memory ^= MemoryKey(Address, Memory.Data[Address]) ^ MemoryKey(Address, Value);
+	Memory.Data[Address] = Value;
+}
+
+constexpr uint64_t Chip8::ComputeMemoryHash() const
+{
+	uint64_t Result = 0;
+	for( size_t i = 0; i < sizeof(Memory.Data); i++ )
+	{
+		Result ^= MemoryKey(i, Memory.Data[i]);
+	}
+	return Result;
+}
+
+constexpr bool Chip8::Execute(const std::chrono::microseconds DeltaTime)
+{
+	// Timers count down for the time that passed since the previous
+	// instruction. Deferring this until now keeps the state left after Tick
+	// valid for all of DeltaTime, so the sound timer is non-zero for exactly
+	// as long as the tone should play.
+	if( Timer.Elapsed >= TimerRate * 1000 )
+	{
+		const uint32_t Ticks = Timer.Elapsed / (TimerRate * 1000);
+		Timer.Elapsed -= Ticks * (TimerRate * 1000);
+		Timer.Delay -= std::min<uint32_t>(Ticks, Timer.Delay);
+		Timer.Sound -= std::min<uint32_t>(Ticks, Timer.Sound);
+	}
+
+#if defined(WUNK8_TRACE)
+	const uint16_t TracePC = Registers.PC;
+	uint8_t TraceV[16] = {};
+	if( Trace )
+	{
+		std::copy_n(std::begin(Registers.V), 16, std::begin(TraceV));
+	}
+#endif
+#if defined(WUNK8_PROFILE)
+	if( Prof )
+	{
+		Prof->BeginInstruction(
+			Registers.PC,
+			(Memory.Data[Registers.PC & 0xFFF] << 8) | Memory.Data[(Registers.PC + 1) & 0xFFF]
+		);
+	}
+#endif
+	// Addresses wrap at the end of memory, so jumps and skips near it can not
+	// fetch from beyond
+	uint16_t Opcode = Memory.Data[Registers.PC & 0xFFF] << 8;
+	Opcode |= Memory.Data[(Registers.PC + 1) & 0xFFF];
+	Registers.PC = (Registers.PC + 2) & 0xFFF;
+	switch( Opcode >> 12 )
+	{
+	case 0x0:
+	{
+		switch( Opcode & 0xFFF )
+		{
+		case 0xE0: // CLS : Clear screen
+		{
+			for( size_t i = 0; i < sizeof(Display.Screen); i++ )
+			{
+				Display.Screen[i] = 0;
+			}
+			Hash.Screen = 0;
+			break;
+		}
+		case 0xEE: // RET : Return from Subroutine
+		{
+			Registers.PC = Stack[0xF & --Registers.SP];
+			break;
+		}
+		}
+		break;
+	}
+	case 0x1: // JP addr
+	{
+		Registers.PC = Opcode & 0x0FFF;
+		break;
+	}
+	case 0x2: // CALL addr
+	{
+		Stack[0xF & Registers.SP++] = Registers.PC;
+		Registers.PC = Opcode & 0x0FFF;
+		break;
+	}
+	case 0x3: // SE : Skip if Equal immediate
+	{
+		// Keep things branchless
+		Registers.PC += 2 * (Registers.V[(Opcode >> 8) & 0xF] == (Opcode & 0xFF));
+		break;
+	}
+	case 0x4: // SNE : Skip if not Equal immediate
+	{
+		Registers.PC += 2 * (Registers.V[(Opcode >> 8) & 0xF] != (Opcode & 0xFF));
+		break;
+	}
+	case 0x5: // SE : Skip if registers equal
+	{
+		Registers.PC += 2 * (Registers.V[(Opcode >> 8) & 0xF] == Registers.V[(Opcode >> 4) & 0xF]);
+		break;
+	}
+	case 0x6: // LD : Load immediate
+	{
+		Registers.V[(Opcode >> 8) & 0xF] = Opcode & 0xFF;
+		break;
+	}
+	case 0x7: // ADD: increment immediate
+	{
+		Registers.V[(Opcode >> 8) & 0xF] += Opcode & 0xFF;
+		break;
+	}
+	case 0x8: // Register operators
+	{
+		uint8_t *Dest = &(Registers.V[(Opcode >> 8) & 0xF]);
+		uint8_t *Operand = &(Registers.V[(Opcode >> 4) & 0xF]);
+		switch( Opcode & 0xF )
+		{
+		case 0: // LD : Load register
+		{
+			*Dest = *Operand;
+			break;
+		}
+		case 1: // OR
+		{
+			*Dest = *Dest | *Operand;
+			break;
+		}
+		case 2: // AND
+		{
+			*Dest = *Dest & *Operand;
+			break;
+		}
+		case 3: // XOR
+		{
+			*Dest = *Dest ^ *Operand;
+			break;
+		}
+		case 4: // ADD /CARRY
+		{
+			Registers.V[0xF] = (
+				(static_cast<size_t>(*Dest) + static_cast<size_t>(*Operand)) > 0xFF
+				);
+			*Dest += *Operand;
+			break;
+		}
+		case 5: // SUB /BORROW
+		{
+			Registers.V[0xF] = (static_cast<size_t>(*Dest) > static_cast<size_t>(*Operand));
+			*Dest -= *Operand;
+			break;
+		}
+		case 6: // SHR
+		{
+			Registers.V[0xF] = *Dest & 1;
+			*Dest >>= 1;
+			break;
+		}
+		case 7: // SUBN
+		{
+			Registers.V[0xF] = (static_cast<size_t>(*Operand) > static_cast<size_t>(*Dest));
+			*Operand -= *Dest;
+			break;
+		}
+		case 0xE: // SHL
+		{
+			Registers.V[0xF] = (*Dest & 0x80) >> 7;
+			*Dest <<= 1;
+			break;
+		}
+		}
+		break;
+	}
+	case 0x9: // SNE : Skip if not Equal
+	{
+		Registers.PC += 2 * (Registers.V[(Opcode >> 8) & 0xF] != Registers.V[(Opcode >> 4) & 0xF]);
+		break;
+	}
+	case 0xA: // LD I : Assign Index register
+	{
+		Registers.I = Opcode & 0x0FFF;
+		break;
+	}
+	case 0xB: // JMP : Relative to V0
+	{
+		Registers.PC = Registers.V[0] + (Opcode & 0xFFF);
+		break;
+	}
+	case 0xC: // Random number generator
+	{
+		Registers.V[(Opcode >> 8) & 0xF] = Random.Next() & (Opcode & 0xFF);
+		break;
+	}
+	case 0xD: // Draw 8xN sprite at (x,y) with collision flag
+	{
+		uint8_t SX = Registers.V[(Opcode >> 8) & 0xF];
+		uint8_t SY = Registers.V[(Opcode >> 4) & 0xF];
+		uint8_t Height = Opcode & 0xF;
+		Registers.V[0xF] = 0;
+		for( size_t Y = 0; Y < Height; Y++ )
+		{
+			uint8_t Pixel = Memory.Data[(Registers.I + Y) & 0xFFF];
+			// Sprites wrap around the edges of the screen
+			const size_t Row = ((SY + Y) % Chip8::Height) * Width;
+			for( size_t X = 0; X < 8; X++ )
+			{
+				if( Pixel & (0x80 >> X) )
+				{
+					const size_t Index = Row + (SX + X) % Width;
+					if( Display.Screen[Index] )
+					{
+						// Collision
+						Registers.V[0xF] = 1;
+					}
+					Display.Screen[Index] ^= 1;
+					Hash.Screen ^= PixelKey(Index);
+				}
+			}
+		}
+
+#if defined(WUNK8_PROFILE)
+		if( Prof )
+		{
+			Prof->Sprite(Height, Registers.V[0xF] != 0);
+		}
+#endif
+		DeltaFrame = true;
+		break;
+	}
+	case 0xE: // Key press conditionals
+	{
+		uint8_t Key = Registers.V[(Opcode >> 8) & 0xF] & 0xF;
+		KeyRead = true;
+		switch( Opcode & 0xFF )
+		{
+		case 0x9E: // SKP : Skip if key is pressed
+		{
+			Registers.PC += 2 * ((Keyboard.KeyStates >> Key) & 1);
+			break;
+		}
+		case 0xA1: // SKNP : Skip if key is not pressed
+		{
+			Registers.PC += 2 * (((Keyboard.KeyStates >> Key) & 1) ^ 1);
+			break;
+		}
+		}
+		break;
+	}
+	case 0xF: //
+	{
+		uint8_t *Arg = &(Registers.V[(Opcode >> 8) & 0xF]);
+		switch( Opcode & 0xFF )
+		{
+		case 0x02: // AUDIO : Load XO-CHIP audio pattern from Index
+		{
+			const size_t Index = Registers.I & 0xFFF;
+			const size_t Length = std::min(sizeof(Audio.Pattern), sizeof(Memory.Data) - Index);
+			for( size_t i = 0; i < Length; i++ )
+			{
+				Audio.Pattern[i] = Memory.Data[Index + i];
+			}
+			Audio.PatternLoaded = true;
+			break;
+		}
+		case 0x07: // LD : Load Delay Timer
+		{
+			*Arg = Timer.Delay;
+			break;
+		}
+		case 0x0A: // LD : Load upon Keypress
+		{
+			KeyRead = true;
+			if( Keyboard.KeyStates == 0 )
+			{
+				// Wait by executing this instruction again
+				Registers.PC -= 2;
+				break;
+			}
+			uint8_t Key = 0;
+			while( !((Keyboard.KeyStates >> Key) & 1) )
+			{
+				Key++;
+			}
+			*Arg = Key;
+			break;
+		}
+		case 0x15: // LD : Set Delay Timer
+		{
+			Timer.Delay = *Arg;
+			break;
+		}
+		case 0x18: // LD: Set Sound Timer
+		{
+			Timer.Sound = *Arg;
+			break;
+		}
+		case 0x3A: // PITCH : Set XO-CHIP audio pattern playback rate
+		{
+			Audio.Pitch = *Arg;
+			break;
+		}
+		case 0x1E: // ADD : Increment Index
+		{
+			Registers.I += *Arg;
+			break;
+		}
+		case 0x29: // LD : Set Index to Letter Sprite address
+		{
+			Registers.I = *Arg * 5;
+			break;
+		}
+		case 0x33: // LD : Store BDC representation of VX at Index
+		{
+			WriteMemory(Registers.I, *Arg / 100);
+			WriteMemory(Registers.I + 1, (*Arg / 10) % 10);
+			WriteMemory(Registers.I + 2, *Arg % 10);
+			break;
+		}
+		case 0x55: // LD : Stores all General Registers V0 to VX at Index
+		{
+			for( size_t i = 0; i <= ((Opcode >> 8) & 0xF); i++ )
+			{
+				WriteMemory(static_cast<uint16_t>(Registers.I + i), Registers.V[i]);
+			}
+			break;
+		}
+		case 0x65: // LD : Read all General Registers V0 to VX from Index
+		{
+			for( size_t i = 0; i <= ((Opcode >> 8) & 0xF); i++ )
+			{
+				Registers.V[i] = Memory.Data[(Registers.I + i) & 0xFFF];
+			}
+			break;
+		}
+		default:
+			break;
+		}
+		break;
+	}
+	}
+
+#if defined(WUNK8_PROFILE)
+	if( Prof )
+	{
+		Prof->EndInstruction();
+	}
+#endif
+#if defined(WUNK8_TRACE)
+	if( Trace )
+	{
+		Trace->Record(Cycles, TracePC, Opcode, Registers.I, TraceV, Registers.V);
+	}
+#endif
+	Cycles++;
+	Timer.Elapsed += static_cast<uint32_t>(DeltaTime.count());
+	return true;
+}
+
+constexpr Chip8 BootImage(
+	const uint8_t *Program, size_t Length, uint64_t Instructions,
+	uint32_t InstructionsPerFrame, uint32_t Seed
+)
+{
+	Chip8 Console(Seed);
+	Console.LoadGame(Program, Length);
+	for( uint64_t i = 0; i < Instructions; i++ )
+	{
+		const uint32_t Slot = static_cast<uint32_t>(i % InstructionsPerFrame);
+		Console.Execute(GetTickTime(Slot, InstructionsPerFrame));
+	}
+	return Console;
+}
 }
\ No newline at end of file
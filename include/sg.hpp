@@ -13,7 +13,7 @@ Simple graphics library.
 
 You must also define one of these
 #define SG_W32       - use W32 implementation
-#define SG_X11       - use X11 implementation (TODO)
+#define SG_X11       - use X11 implementation, link with -lX11 -lXext
 
 sg_init(title, w, h) - initialize and open a window with dimension w*h
 sg_exit()            - cleanup.
@@ -22,6 +22,15 @@ sg_paint(buf, w, h)  - draw buf consisting of w*h 32 bit pixels onto window,
 will stretch to fit window size.
 sg_time()            - return time in seconds since sg_init().
 sg_delay(s)          - sleep for at least s seconds.
+
+-- X11 notes
+
+The X11 implementation paints through MIT-SHM shared memory images when the
+server is local and falls back to XPutImage otherwise. Pixels are scaled
+straight into the image with nearest filtering, so sg_paint only allocates
+when the window has been resized. When no display can be opened, sg_init
+prints a message and every other call becomes a no-op, which allows running
+headless or under Xvfb.
 */
 
 #ifdef SG_STATIC
@@ -332,7 +341,431 @@ SGDEF void sg_delay(double t)
 		Sleep((DWORD)(t*1000.0));
 }
 
+#elif defined(SG_X11)
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/XKBlib.h>
+#include <X11/keysym.h>
+#include <X11/extensions/XShm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+static struct
+{
+	Display         *dpy;
+	Window           win;
+	GC               gc;
+	Visual          *vis;
+	int              depth;
+	Atom             wmdelete;
+	int              init;
+	int              winw;
+	int              winh;
+	int              shmevent;
+	int              shmpending;
+	int              useshm;
+	XShmSegmentInfo  shminfo;
+	XImage          *img;
+	int             *xmap;
+	int              mapw;
+	int              srcw;
+	int              srch;
+	unsigned char    keydown[256];
+	struct timespec  tbase;
+	unsigned         qhead;
+	sg_event         qdata[64];
+	unsigned         qtail;
+} sg_x11;
+
+/* single threaded queue for translated events, an X event may produce
+more than one sg event (keydown + keychar) */
+static void sg_x11_qwrite(const sg_event *ev)
+{
+	unsigned ntail = (sg_x11.qtail + 1) & 63;
+	if( ntail == sg_x11.qhead )
+		return;
+	sg_x11.qdata[sg_x11.qtail] = *ev;
+	sg_x11.qtail = ntail;
+}
+
+static int sg_x11_qread(sg_event *ev)
+{
+	if( sg_x11.qhead == sg_x11.qtail )
+		return 0;
+	*ev = sg_x11.qdata[sg_x11.qhead];
+	sg_x11.qhead = (sg_x11.qhead + 1) & 63;
+	return 1;
+}
+
+static int sg_x11_shmerror;
+static int sg_x11_errhandler(Display *dpy, XErrorEvent *err)
+{
+	(void)dpy;
+	(void)err;
+	sg_x11_shmerror = 1;
+	return 0;
+}
+
+static int sg_x11_keymap(KeySym ks)
+{
+	if( ks >= XK_a && ks <= XK_z )
+		return 'a' + (int)(ks - XK_a);
+	if( ks >= XK_A && ks <= XK_Z )
+		return 'a' + (int)(ks - XK_A);
+	if( ks >= XK_0 && ks <= XK_9 )
+		return '0' + (int)(ks - XK_0);
+	if( ks >= XK_F1 && ks <= XK_F12 )
+		return SG_key_f1 + (int)(ks - XK_F1);
+	switch( ks )
+	{
+	case XK_BackSpace: return '\b';
+	case XK_Tab:       return '\t';
+	case XK_Return:    return '\r';
+	case XK_space:     return ' ';
+	case XK_Escape:    return SG_key_esc;
+	case XK_Shift_L:
+	case XK_Shift_R:   return SG_key_shift;
+	case XK_Control_L:
+	case XK_Control_R: return SG_key_ctrl;
+	case XK_Alt_L:
+	case XK_Alt_R:     return SG_key_alt;
+	case XK_Up:        return SG_key_up;
+	case XK_Down:      return SG_key_down;
+	case XK_Left:      return SG_key_left;
+	case XK_Right:     return SG_key_right;
+	case XK_Insert:    return SG_key_ins;
+	case XK_Delete:    return SG_key_del;
+	case XK_Home:      return SG_key_home;
+	case XK_End:       return SG_key_end;
+	case XK_Prior:     return SG_key_pgup;
+	case XK_Next:      return SG_key_pgdn;
+	}
+	return 0;
+}
+
+static void sg_x11_freeimage(void)
+{
+	if( !sg_x11.img )
+		return;
+	if( sg_x11.useshm )
+	{
+		XShmDetach(sg_x11.dpy, &sg_x11.shminfo);
+		XSync(sg_x11.dpy, False);
+		sg_x11.img->data = 0;
+		XDestroyImage(sg_x11.img);
+		shmdt(sg_x11.shminfo.shmaddr);
+	}
+	else
+	{
+		/* XDestroyImage frees the malloc'ed pixel data */
+		XDestroyImage(sg_x11.img);
+	}
+	sg_x11.img = 0;
+	sg_x11.shmpending = 0;
+}
+
+/* (re)creates the window sized image, only called when the size changes */
+static int sg_x11_allocimage(int w, int h)
+{
+	sg_x11_freeimage();
+	if( sg_x11.useshm )
+	{
+		int (*olderr)(Display *, XErrorEvent *);
+		sg_x11.img = XShmCreateImage(sg_x11.dpy, sg_x11.vis, sg_x11.depth,
+									 ZPixmap, 0, &sg_x11.shminfo, w, h);
+		if( sg_x11.img )
+		{
+			sg_x11.shminfo.shmid = shmget(IPC_PRIVATE,
+				(size_t)sg_x11.img->bytes_per_line * h, IPC_CREAT | 0600);
+			sg_x11.shminfo.shmaddr = sg_x11.shminfo.shmid < 0 ? (char *)-1 :
+				(char *)shmat(sg_x11.shminfo.shmid, 0, 0);
+			if( sg_x11.shminfo.shmaddr != (char *)-1 )
+			{
+				sg_x11.img->data = sg_x11.shminfo.shmaddr;
+				sg_x11.shminfo.readOnly = False;
+				/* attaching fails asynchronously for remote displays */
+				sg_x11_shmerror = 0;
+				olderr = XSetErrorHandler(sg_x11_errhandler);
+				XShmAttach(sg_x11.dpy, &sg_x11.shminfo);
+				XSync(sg_x11.dpy, False);
+				XSetErrorHandler(olderr);
+				/* segment is released once both sides detach */
+				shmctl(sg_x11.shminfo.shmid, IPC_RMID, 0);
+				if( !sg_x11_shmerror )
+					return 1;
+				shmdt(sg_x11.shminfo.shmaddr);
+			}
+			else if( sg_x11.shminfo.shmid >= 0 )
+				shmctl(sg_x11.shminfo.shmid, IPC_RMID, 0);
+			sg_x11.img->data = 0;
+			XDestroyImage(sg_x11.img);
+			sg_x11.img = 0;
+		}
+		sg_x11.useshm = 0;
+	}
+	sg_x11.img = XCreateImage(sg_x11.dpy, sg_x11.vis, sg_x11.depth, ZPixmap, 0,
+							  0, w, h, 32, 0);
+	if( !sg_x11.img )
+		return 0;
+	sg_x11.img->data = (char *)malloc((size_t)sg_x11.img->bytes_per_line * h);
+	if( !sg_x11.img->data )
+	{
+		XDestroyImage(sg_x11.img);
+		sg_x11.img = 0;
+		return 0;
+	}
+	return 1;
+}
+
+static void sg_x11_translate(XEvent *xe)
+{
+	sg_event ev = { 0, 0, 0.0f, 0.0f };
+	char text[8];
+	KeySym ks;
+	int key;
+
+	switch( xe->type )
+	{
+	case KeyPress:
+	case KeyRelease:
+		ks = XLookupKeysym(&xe->xkey, 0);
+		key = sg_x11_keymap(ks);
+		if( key )
+		{
+			/* drop auto-repeat the same way the W32 backend does */
+			int down = xe->type == KeyPress;
+			if( sg_x11.keydown[key] != down )
+			{
+				sg_x11.keydown[key] = (unsigned char)down;
+				ev.type = down ? SG_ev_keydown : SG_ev_keyup;
+				ev.key = key;
+				sg_x11_qwrite(&ev);
+			}
+		}
+		if( xe->type == KeyPress &&
+			XLookupString(&xe->xkey, text, sizeof(text), 0, 0) == 1 )
+		{
+			ev.type = SG_ev_keychar;
+			ev.key = (unsigned char)text[0];
+			sg_x11_qwrite(&ev);
+		}
+		break;
+	case ButtonPress:
+	case ButtonRelease:
+		if( xe->xbutton.button < Button1 || xe->xbutton.button > Button5 )
+			break;
+		ev.type = xe->type == ButtonPress ? SG_ev_keydown : SG_ev_keyup;
+		/* X11 numbers the middle button 2 and the right button 3 */
+		switch( xe->xbutton.button )
+		{
+		case Button1: ev.key = SG_key_mb1; break;
+		case Button2: ev.key = SG_key_mb2; break;
+		case Button3: ev.key = SG_key_mb3; break;
+		case Button4: ev.key = SG_key_mb4; break;
+		case Button5: ev.key = SG_key_mb5; break;
+		}
+		sg_x11_qwrite(&ev);
+		break;
+	case MotionNotify:
+		ev.type = SG_ev_mouse;
+		ev.mx = xe->xmotion.x / (float)(sg_x11.winw ? sg_x11.winw : 1);
+		ev.my = xe->xmotion.y / (float)(sg_x11.winh ? sg_x11.winh : 1);
+		sg_x11_qwrite(&ev);
+		break;
+	case ConfigureNotify:
+		sg_x11.winw = xe->xconfigure.width;
+		sg_x11.winh = xe->xconfigure.height;
+		break;
+	case ClientMessage:
+		if( (Atom)xe->xclient.data.l[0] == sg_x11.wmdelete )
+		{
+			ev.type = SG_ev_quit;
+			sg_x11_qwrite(&ev);
+		}
+		break;
+	default:
+		if( xe->type == sg_x11.shmevent )
+			sg_x11.shmpending = 0;
+		break;
+	}
+}
+
+static void sg_x11_pump(void)
+{
+	XEvent xe;
+	while( XPending(sg_x11.dpy) )
+	{
+		XNextEvent(sg_x11.dpy, &xe);
+		sg_x11_translate(&xe);
+	}
+}
+
+SGDEF void sg_init(const char *title, int w, int h)
+{
+	XSizeHints hints;
+	int major, minor;
+	Bool pixmaps;
+
+	clock_gettime(CLOCK_MONOTONIC, &sg_x11.tbase);
+	sg_x11.dpy = XOpenDisplay(0);
+	if( !sg_x11.dpy )
+	{
+		fprintf(stderr, "sg: unable to open X display, running without a window\n");
+		return;
+	}
+	sg_x11.vis = DefaultVisual(sg_x11.dpy, DefaultScreen(sg_x11.dpy));
+	sg_x11.depth = DefaultDepth(sg_x11.dpy, DefaultScreen(sg_x11.dpy));
+	if( sg_x11.depth < 24 || sg_x11.vis->red_mask != 0xff0000 ||
+		sg_x11.vis->blue_mask != 0xff )
+	{
+		fprintf(stderr, "sg: X visual is not 32 bit BGRX, running without a window\n");
+		XCloseDisplay(sg_x11.dpy);
+		sg_x11.dpy = 0;
+		return;
+	}
+	sg_x11.win = XCreateSimpleWindow(sg_x11.dpy, DefaultRootWindow(sg_x11.dpy),
+									 0, 0, (unsigned)w, (unsigned)h, 0, 0, 0);
+	XStoreName(sg_x11.dpy, sg_x11.win, title);
+	hints.flags = PMinSize;
+	hints.min_width = 1;
+	hints.min_height = 1;
+	XSetWMNormalHints(sg_x11.dpy, sg_x11.win, &hints);
+	XSelectInput(sg_x11.dpy, sg_x11.win, KeyPressMask | KeyReleaseMask |
+				 ButtonPressMask | ButtonReleaseMask | PointerMotionMask |
+				 StructureNotifyMask);
+	sg_x11.wmdelete = XInternAtom(sg_x11.dpy, "WM_DELETE_WINDOW", False);
+	XSetWMProtocols(sg_x11.dpy, sg_x11.win, &sg_x11.wmdelete, 1);
+	XkbSetDetectableAutoRepeat(sg_x11.dpy, True, 0);
+	sg_x11.gc = XCreateGC(sg_x11.dpy, sg_x11.win, 0, 0);
+	sg_x11.useshm = XShmQueryVersion(sg_x11.dpy, &major, &minor, &pixmaps);
+	sg_x11.shmevent = sg_x11.useshm ?
+		XShmGetEventBase(sg_x11.dpy) + ShmCompletion : -1;
+	XMapWindow(sg_x11.dpy, sg_x11.win);
+	XFlush(sg_x11.dpy);
+	sg_x11.winw = w;
+	sg_x11.winh = h;
+	sg_x11.init = 1;
+}
+
+SGDEF void sg_exit(void)
+{
+	if( !sg_x11.init )
+		return;
+	sg_x11_freeimage();
+	free(sg_x11.xmap);
+	XFreeGC(sg_x11.dpy, sg_x11.gc);
+	XDestroyWindow(sg_x11.dpy, sg_x11.win);
+	XCloseDisplay(sg_x11.dpy);
+	memset(&sg_x11, 0, sizeof(sg_x11));
+}
+
+SGDEF int sg_poll(sg_event *ev)
+{
+	if( !sg_x11.init )
+		return 0;
+	if( sg_x11_qread(ev) )
+		return 1;
+	sg_x11_pump();
+	return sg_x11_qread(ev);
+}
+
+SGDEF void sg_paint(const void *buf, int w, int h)
+{
+	const unsigned *src = (const unsigned *)buf;
+	int dw, dh, x, y, sy, prevsy;
+	char *row;
+
+	if( !sg_x11.init )
+		return;
+	sg_x11_pump();
+	dw = sg_x11.winw;
+	dh = sg_x11.winh;
+	if( dw <= 0 || dh <= 0 )
+		return;
+
+	/* the server may still be reading the previous frame */
+	while( sg_x11.shmpending )
+	{
+		XEvent xe;
+		XNextEvent(sg_x11.dpy, &xe);
+		sg_x11_translate(&xe);
+	}
+
+	if( !sg_x11.img || sg_x11.img->width != dw || sg_x11.img->height != dh )
+	{
+		if( !sg_x11_allocimage(dw, dh) )
+			return;
+		sg_x11.srcw = 0;
+	}
+	if( sg_x11.srcw != w || sg_x11.srch != h )
+	{
+		if( sg_x11.mapw < dw )
+		{
+			free(sg_x11.xmap);
+			sg_x11.xmap = (int *)malloc(sizeof(int) * (size_t)dw);
+			sg_x11.mapw = sg_x11.xmap ? dw : 0;
+			if( !sg_x11.xmap )
+				return;
+		}
+		for( x = 0; x < dw; x++ )
+			sg_x11.xmap[x] = (int)((long)x * w / dw);
+		sg_x11.srcw = w;
+		sg_x11.srch = h;
+	}
+
+	/* nearest filtering, rows that sample the same source row are copied */
+	prevsy = -1;
+	for( y = 0; y < dh; y++ )
+	{
+		row = sg_x11.img->data + (size_t)y * sg_x11.img->bytes_per_line;
+		sy = (int)((long)y * h / dh);
+		if( sy == prevsy )
+		{
+			memcpy(row, row - sg_x11.img->bytes_per_line, (size_t)dw * 4);
+			continue;
+		}
+		for( x = 0; x < dw; x++ )
+			((unsigned *)row)[x] = src[sy * w + sg_x11.xmap[x]];
+		prevsy = sy;
+	}
+
+	if( sg_x11.useshm )
+	{
+		XShmPutImage(sg_x11.dpy, sg_x11.win, sg_x11.gc, sg_x11.img,
+					 0, 0, 0, 0, (unsigned)dw, (unsigned)dh, True);
+		sg_x11.shmpending = 1;
+	}
+	else
+		XPutImage(sg_x11.dpy, sg_x11.win, sg_x11.gc, sg_x11.img,
+				  0, 0, 0, 0, (unsigned)dw, (unsigned)dh);
+	XFlush(sg_x11.dpy);
+}
+
+SGDEF double sg_time(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (double)(t.tv_sec - sg_x11.tbase.tv_sec) +
+		(double)(t.tv_nsec - sg_x11.tbase.tv_nsec) * 1e-9;
+}
+
+SGDEF void sg_delay(double t)
+{
+	struct timespec ts;
+	if( t <= 0.0 )
+		return;
+	ts.tv_sec = (time_t)t;
+	ts.tv_nsec = (long)((t - (double)ts.tv_sec) * 1e9);
+	while( nanosleep(&ts, &ts) != 0 && errno == EINTR )
+		;
+}
+
 #else
-#error must define SG_W32
+#error must define SG_W32 or SG_X11
 #endif
 #endif
\ No newline at end of file
@@ -0,0 +1,127 @@
+#ifndef WUNK8_H
+#define WUNK8_H
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * C interface to the Wunk8 Chip8 emulator, exported by libwunk8.
+ * Functions returning int return 0 on success and -1 on failure.
+ * Handles are not thread-safe, but separate handles may be used from
+ * separate threads.
+ */
+
+#if defined(_WIN32)
+#if defined(WUNK8_BUILD_SHARED)
+#define WUNK8_API __declspec(dllexport)
+#elif defined(WUNK8_SHARED)
+#define WUNK8_API __declspec(dllimport)
+#else
+#define WUNK8_API
+#endif
+#else
+#define WUNK8_API __attribute__((visibility("default")))
+#endif
+
+#define WUNK8_SCREEN_WIDTH 64
+#define WUNK8_SCREEN_HEIGHT 32
+#define WUNK8_MEMORY_SIZE 4096
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Interface version, bumped whenever a function changes incompatibly */
+WUNK8_API uint32_t wunk8_version(void);
+
+/* Single consoles */
+typedef struct wunk8_chip8 wunk8_chip8;
+
+/* Returns NULL on failure */
+WUNK8_API wunk8_chip8 *wunk8_create(uint32_t seed);
+/* Copies a console along with its entire state */
+WUNK8_API wunk8_chip8 *wunk8_clone(const wunk8_chip8 *chip8);
+WUNK8_API void wunk8_destroy(wunk8_chip8 *chip8);
+
+WUNK8_API void wunk8_reset(wunk8_chip8 *chip8);
+/* Resets and loads a program from memory */
+WUNK8_API int wunk8_load(wunk8_chip8 *chip8, const void *rom, size_t rom_size);
+
+/* Runs count instructions, each followed by microseconds of timer time.
+ * 10 instructions a frame at 60 frames a second is 1600. Returns the
+ * instructions executed since the last reset. */
+WUNK8_API uint64_t wunk8_run(wunk8_chip8 *chip8, uint32_t count, uint32_t microseconds);
+WUNK8_API uint64_t wunk8_cycles(const wunk8_chip8 *chip8);
+
+/* Keys are 0x0 to 0xF, masks hold bit n for key n */
+WUNK8_API void wunk8_key_down(wunk8_chip8 *chip8, uint8_t key);
+WUNK8_API void wunk8_key_up(wunk8_chip8 *chip8, uint8_t key);
+WUNK8_API void wunk8_set_keys(wunk8_chip8 *chip8, uint16_t mask);
+WUNK8_API uint16_t wunk8_get_keys(const wunk8_chip8 *chip8);
+
+/* WUNK8_SCREEN_WIDTH * WUNK8_SCREEN_HEIGHT bytes, 1 for lit pixels */
+WUNK8_API const uint8_t *wunk8_screen(const wunk8_chip8 *chip8);
+/* Whether the screen was drawn to since the last call */
+WUNK8_API int wunk8_frame_drawn(wunk8_chip8 *chip8);
+/* WUNK8_MEMORY_SIZE bytes */
+WUNK8_API const uint8_t *wunk8_memory(const wunk8_chip8 *chip8);
+WUNK8_API int wunk8_sound_active(const wunk8_chip8 *chip8);
+
+/* Hash of the complete machine state excluding the keypad, and of the
+ * screen alone */
+WUNK8_API uint64_t wunk8_state_hash(const wunk8_chip8 *chip8);
+WUNK8_API uint64_t wunk8_screen_hash(const wunk8_chip8 *chip8);
+
+/* Machine state as bytes, only valid for the same build of the library */
+WUNK8_API size_t wunk8_state_size(void);
+WUNK8_API int wunk8_save_state(const wunk8_chip8 *chip8, void *state, size_t size);
+WUNK8_API int wunk8_load_state(wunk8_chip8 *chip8, const void *state, size_t size);
+
+/* Vectorized environments
+ * Many consoles running one program, stepped together. Each step holds a
+ * keypad state on every console for its own number of frames and writes
+ * observations into a caller-provided array, without allocating.
+ */
+typedef struct wunk8_vec_env wunk8_vec_env;
+
+/* Console i is seeded with seed + i. Returns NULL on failure. */
+WUNK8_API wunk8_vec_env *wunk8_vec_env_create(
+	size_t count, uint32_t instructions_per_frame, uint32_t seed
+);
+WUNK8_API void wunk8_vec_env_destroy(wunk8_vec_env *env);
+
+/* Loads a program into every console and makes it the reset state */
+WUNK8_API int wunk8_vec_env_load(wunk8_vec_env *env, const void *rom, size_t rom_size);
+
+/* Returns one console to the reset state */
+WUNK8_API int wunk8_vec_env_reset(wunk8_vec_env *env, size_t index);
+WUNK8_API void wunk8_vec_env_reset_all(wunk8_vec_env *env);
+
+/* Observe the screen at 1 bit per pixel, 256 bytes per console, rows of 8
+ * bytes with the most significant bit leftmost */
+WUNK8_API void wunk8_vec_env_observe_screen(wunk8_vec_env *env);
+/* Observe the bytes at the given addresses, count bytes per console */
+WUNK8_API int wunk8_vec_env_observe_memory(
+	wunk8_vec_env *env, const uint16_t *addresses, size_t count
+);
+WUNK8_API size_t wunk8_vec_env_observation_size(const wunk8_vec_env *env);
+
+/* Sets console i's keypad to keys[i], bit n for key n, runs frames[i]
+ * frames and writes its observation at observations + i * size.
+ * NULL keys keeps the keypads, NULL frames runs one frame each and NULL
+ * observations skips writing them. */
+WUNK8_API void wunk8_vec_env_step(
+	wunk8_vec_env *env,
+	const uint16_t *keys, const uint32_t *frames, uint8_t *observations
+);
+
+/* Writes every console's observation without running */
+WUNK8_API void wunk8_vec_env_observe(const wunk8_vec_env *env, uint8_t *observations);
+
+/* Hash of console index's complete machine state, excluding the keypad */
+WUNK8_API uint64_t wunk8_vec_env_state_hash(const wunk8_vec_env *env, size_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,233 @@
+#include "Audio.hpp"
+#include "Wunk8.hpp"
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+namespace Wunk8
+{
+constexpr uint32_t Synthesizer::ToneFrequency;
+constexpr int16_t Synthesizer::Amplitude;
+constexpr size_t AudioOutput::Period;
+
+Synthesizer::Synthesizer(AudioBuffer &Output, uint32_t SampleRate)
+	:
+	Output(Output),
+	SampleRate(SampleRate),
+	Remainder(0),
+	TonePhase(0),
+	ToneStep(static_cast<uint32_t>((uint64_t(ToneFrequency) << 32) / SampleRate)),
+	PatternPhase(0),
+	PatternStep(0),
+	PatternPitch(-1),
+	Samples(0),
+	Overruns(0)
+{
+}
+
+void Synthesizer::Advance(const Chip8 &Console, std::chrono::microseconds DeltaTime)
+{
+	// Integer bookkeeping so rounding never drifts from the emulated clock
+	Remainder += static_cast<uint64_t>(DeltaTime.count()) * SampleRate;
+	size_t Count = static_cast<size_t>(Remainder / 1000000);
+	Remainder %= 1000000;
+
+	int16_t Buffer[256];
+	while( Count )
+	{
+		const size_t CurCount = std::min(Count, sizeof(Buffer) / sizeof(int16_t));
+		Render(Console, Buffer, CurCount);
+		const size_t Pushed = Output.Push(Buffer, CurCount);
+		Samples.fetch_add(CurCount, std::memory_order_relaxed);
+		if( Pushed != CurCount )
+		{
+			Overruns.fetch_add(CurCount - Pushed, std::memory_order_relaxed);
+		}
+		Count -= CurCount;
+	}
+}
+
+void Synthesizer::Render(const Chip8 &Console, int16_t *Buffer, size_t Count)
+{
+	if( !Console.IsSoundActive() )
+	{
+		std::fill_n(Buffer, Count, 0);
+		return;
+	}
+
+	if( !Console.HasAudioPattern() )
+	{
+		for( size_t i = 0; i < Count; i++ )
+		{
+			Buffer[i] = (TonePhase & 0x80000000) ? Amplitude : -Amplitude;
+			TonePhase += ToneStep;
+		}
+		return;
+	}
+
+	// XO-CHIP: 4000*2^((Pitch-64)/48) pattern bits per second
+	if( PatternPitch != Console.GetAudioPitch() )
+	{
+		PatternPitch = Console.GetAudioPitch();
+		const double BitRate = 4000.0 * pow(2.0, (PatternPitch - 64) / 48.0);
+		PatternStep = static_cast<uint32_t>(BitRate / SampleRate * (1u << 25));
+	}
+	const uint8_t *Pattern = Console.GetAudioPattern();
+	for( size_t i = 0; i < Count; i++ )
+	{
+		const uint32_t Bit = PatternPhase >> 25;
+		Buffer[i] = ((Pattern[Bit >> 3] << (Bit & 7)) & 0x80) ? Amplitude : -Amplitude;
+		PatternPhase += PatternStep;
+	}
+}
+
+AudioSink::~AudioSink()
+{
+}
+
+WavSink::WavSink(const std::string &FileName, uint32_t SampleRate)
+	:
+	File(fopen(FileName.c_str(), "wb")),
+	SampleRate(SampleRate),
+	DataSize(0)
+{
+	if( File )
+	{
+		WriteHeader();
+	}
+}
+
+WavSink::~WavSink()
+{
+	if( File )
+	{
+		fseek(File, 0, SEEK_SET);
+		WriteHeader();
+		fclose(File);
+	}
+}
+
+void WavSink::WriteHeader()
+{
+	const uint32_t DataBytes = static_cast<uint32_t>(
+		std::min<uint64_t>(DataSize, 0xFFFFFFFF - 36)
+	);
+	const uint32_t ByteRate = SampleRate * sizeof(int16_t);
+	uint8_t Header[44];
+	const auto Put32 = [&Header](size_t Offset, uint32_t Value)
+	{
+		for( size_t i = 0; i < 4; i++ )
+		{
+			Header[Offset + i] = static_cast<uint8_t>(Value >> (i * 8));
+		}
+	};
+	const auto Put16 = [&Header](size_t Offset, uint16_t Value)
+	{
+		Header[Offset] = static_cast<uint8_t>(Value);
+		Header[Offset + 1] = static_cast<uint8_t>(Value >> 8);
+	};
+	memcpy(Header + 0, "RIFF", 4);
+	Put32(4, 36 + DataBytes);
+	memcpy(Header + 8, "WAVEfmt ", 8);
+	Put32(16, 16);
+	Put16(20, 1); // PCM
+	Put16(22, 1); // Mono
+	Put32(24, SampleRate);
+	Put32(28, ByteRate);
+	Put16(32, sizeof(int16_t));
+	Put16(34, 16);
+	memcpy(Header + 36, "data", 4);
+	Put32(40, DataBytes);
+	fwrite(Header, sizeof(Header), 1, File);
+}
+
+void WavSink::Write(const int16_t *Buffer, size_t Count)
+{
+	if( File )
+	{
+		// Samples are stored little-endian, same as the host
+		fwrite(Buffer, sizeof(int16_t), Count, File);
+		DataSize += Count * sizeof(int16_t);
+	}
+}
+
+RawSink::RawSink(FILE *Stream)
+	:
+	Stream(Stream)
+{
+}
+
+void RawSink::Write(const int16_t *Buffer, size_t Count)
+{
+	fwrite(Buffer, sizeof(int16_t), Count, Stream);
+	fflush(Stream);
+}
+
+AudioOutput::AudioOutput(AudioBuffer &Input, AudioSink &Sink, uint32_t SampleRate)
+	:
+	Input(Input),
+	Sink(Sink),
+	SampleRate(SampleRate),
+	Running(true),
+	Samples(0),
+	Underruns(0),
+	Thread(&AudioOutput::Run, this)
+{
+}
+
+AudioOutput::~AudioOutput()
+{
+	Running.store(false, std::memory_order_relaxed);
+	Thread.join();
+	Drain();
+}
+
+void AudioOutput::Drain()
+{
+	int16_t Buffer[Period];
+	while( const size_t Count = Input.Pop(Buffer, Period) )
+	{
+		Sink.Write(Buffer, Count);
+		Samples.fetch_add(Count, std::memory_order_relaxed);
+	}
+}
+
+void AudioOutput::Run()
+{
+	int16_t Buffer[Period];
+	if( !Sink.IsRealtime() )
+	{
+		while( Running.load(std::memory_order_relaxed) )
+		{
+			Drain();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return;
+	}
+
+	// Let a couple of periods accumulate before playback begins
+	while( Running.load(std::memory_order_relaxed) && Input.Size() < Period * 2 )
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	const auto PeriodTime = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		std::chrono::duration<double>(double(Period) / SampleRate)
+	);
+	auto Deadline = std::chrono::steady_clock::now();
+	while( Running.load(std::memory_order_relaxed) )
+	{
+		const size_t Count = Input.Pop(Buffer, Period);
+		if( Count < Period )
+		{
+			std::fill(Buffer + Count, Buffer + Period, 0);
+			Underruns.fetch_add(1, std::memory_order_relaxed);
+		}
+		Sink.Write(Buffer, Period);
+		Samples.fetch_add(Period, std::memory_order_relaxed);
+		Deadline += PeriodTime;
+		std::this_thread::sleep_until(Deadline);
+	}
+}
+}
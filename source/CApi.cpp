@@ -0,0 +1,261 @@
+#include "wunk8.h"
+#include "VectorEnv.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+// Opaque handles are the C++ objects themselves
+struct wunk8_chip8 : Wunk8::Chip8
+{
+	using Wunk8::Chip8::Chip8;
+};
+
+struct wunk8_vec_env : Wunk8::VectorEnv
+{
+	using Wunk8::VectorEnv::VectorEnv;
+};
+
+extern "C"
+{
+uint32_t wunk8_version(void)
+{
+	return 1;
+}
+
+wunk8_chip8 *wunk8_create(uint32_t seed)
+{
+	// No exceptions may cross into C
+	try
+	{
+		return new wunk8_chip8(seed);
+	}
+	catch( ... )
+	{
+		return nullptr;
+	}
+}
+
+wunk8_chip8 *wunk8_clone(const wunk8_chip8 *chip8)
+{
+	try
+	{
+		wunk8_chip8 *Copy = new wunk8_chip8();
+		Copy->LoadState(*chip8);
+		return Copy;
+	}
+	catch( ... )
+	{
+		return nullptr;
+	}
+}
+
+void wunk8_destroy(wunk8_chip8 *chip8)
+{
+	delete chip8;
+}
+
+void wunk8_reset(wunk8_chip8 *chip8)
+{
+	chip8->Reset();
+}
+
+int wunk8_load(wunk8_chip8 *chip8, const void *rom, size_t rom_size)
+{
+	if( rom == nullptr )
+	{
+		return -1;
+	}
+	chip8->Reset();
+	return chip8->LoadGame(rom, rom_size) ? 0 : -1;
+}
+
+uint64_t wunk8_run(wunk8_chip8 *chip8, uint32_t count, uint32_t microseconds)
+{
+	const std::chrono::microseconds DeltaTime(microseconds);
+	for( uint32_t i = 0; i < count; i++ )
+	{
+		if( !chip8->Tick(DeltaTime) )
+		{
+			break;
+		}
+	}
+	return chip8->GetCycles();
+}
+
+uint64_t wunk8_cycles(const wunk8_chip8 *chip8)
+{
+	return chip8->GetCycles();
+}
+
+void wunk8_key_down(wunk8_chip8 *chip8, uint8_t key)
+{
+	chip8->KeyDown(static_cast<uint16_t>(1 << (key & 0xF)));
+}
+
+void wunk8_key_up(wunk8_chip8 *chip8, uint8_t key)
+{
+	chip8->KeyUp(static_cast<uint16_t>(1 << (key & 0xF)));
+}
+
+void wunk8_set_keys(wunk8_chip8 *chip8, uint16_t mask)
+{
+	chip8->KeyUp(0xFFFF);
+	chip8->KeyDown(mask);
+}
+
+uint16_t wunk8_get_keys(const wunk8_chip8 *chip8)
+{
+	return chip8->GetKeys();
+}
+
+const uint8_t *wunk8_screen(const wunk8_chip8 *chip8)
+{
+	return chip8->GetScreen();
+}
+
+int wunk8_frame_drawn(wunk8_chip8 *chip8)
+{
+	return chip8->QueryFrame() ? 1 : 0;
+}
+
+const uint8_t *wunk8_memory(const wunk8_chip8 *chip8)
+{
+	return chip8->GetMemory();
+}
+
+int wunk8_sound_active(const wunk8_chip8 *chip8)
+{
+	return chip8->IsSoundActive() ? 1 : 0;
+}
+
+uint64_t wunk8_state_hash(const wunk8_chip8 *chip8)
+{
+	return chip8->GetStateHash();
+}
+
+uint64_t wunk8_screen_hash(const wunk8_chip8 *chip8)
+{
+	return chip8->GetScreenHash();
+}
+
+size_t wunk8_state_size(void)
+{
+	return sizeof(Wunk8::Chip8);
+}
+
+int wunk8_save_state(const wunk8_chip8 *chip8, void *state, size_t size)
+{
+	if( state == nullptr || size < sizeof(Wunk8::Chip8) )
+	{
+		return -1;
+	}
+	// Copy into an instance without a profiler or tracer so no host
+	// pointers end up in the bytes
+	Wunk8::Chip8 Snapshot;
+	Snapshot.LoadState(*chip8);
+	const uint8_t *Bytes = reinterpret_cast<const uint8_t*>(&Snapshot);
+	std::copy_n(Bytes, sizeof(Wunk8::Chip8), static_cast<uint8_t*>(state));
+	return 0;
+}
+
+int wunk8_load_state(wunk8_chip8 *chip8, const void *state, size_t size)
+{
+	if( state == nullptr || size != sizeof(Wunk8::Chip8) )
+	{
+		return -1;
+	}
+	Wunk8::Chip8 Snapshot;
+	std::copy_n(
+		static_cast<const uint8_t*>(state), sizeof(Wunk8::Chip8),
+		reinterpret_cast<uint8_t*>(&Snapshot)
+	);
+	chip8->LoadState(Snapshot);
+	return 0;
+}
+
+wunk8_vec_env *wunk8_vec_env_create(
+	size_t count, uint32_t instructions_per_frame, uint32_t seed
+)
+{
+	try
+	{
+		return new wunk8_vec_env(count, instructions_per_frame, seed);
+	}
+	catch( ... )
+	{
+		return nullptr;
+	}
+}
+
+void wunk8_vec_env_destroy(wunk8_vec_env *env)
+{
+	delete env;
+}
+
+int wunk8_vec_env_load(wunk8_vec_env *env, const void *rom, size_t rom_size)
+{
+	return rom != nullptr && env->LoadGame(rom, rom_size) ? 0 : -1;
+}
+
+int wunk8_vec_env_reset(wunk8_vec_env *env, size_t index)
+{
+	if( index >= env->GetCount() )
+	{
+		return -1;
+	}
+	env->Reset(index);
+	return 0;
+}
+
+void wunk8_vec_env_reset_all(wunk8_vec_env *env)
+{
+	env->ResetAll();
+}
+
+void wunk8_vec_env_observe_screen(wunk8_vec_env *env)
+{
+	env->ObserveScreen();
+}
+
+int wunk8_vec_env_observe_memory(
+	wunk8_vec_env *env, const uint16_t *addresses, size_t count
+)
+{
+	if( addresses == nullptr && count != 0 )
+	{
+		return -1;
+	}
+	try
+	{
+		env->ObserveMemory(addresses, count);
+	}
+	catch( ... )
+	{
+		return -1;
+	}
+	return 0;
+}
+
+size_t wunk8_vec_env_observation_size(const wunk8_vec_env *env)
+{
+	return env->GetObservationSize();
+}
+
+void wunk8_vec_env_step(
+	wunk8_vec_env *env,
+	const uint16_t *keys, const uint32_t *frames, uint8_t *observations
+)
+{
+	env->Step(keys, frames, observations);
+}
+
+void wunk8_vec_env_observe(const wunk8_vec_env *env, uint8_t *observations)
+{
+	env->Observe(observations);
+}
+
+uint64_t wunk8_vec_env_state_hash(const wunk8_vec_env *env, size_t index)
+{
+	return index < env->GetCount() ? env->GetConsole(index).GetStateHash() : 0;
+}
+}
@@ -0,0 +1,304 @@
+#include "CommandServer.hpp"
+
+#include <algorithm>
+
+#if !defined(_WIN32)
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace Wunk8
+{
+namespace
+{
+// Larger than any program, small enough to reject garbage lengths
+constexpr uint32_t MaxMessage = 1 << 20;
+
+bool ReadAll(int File, uint8_t *Data, size_t Length)
+{
+#if defined(_WIN32)
+	(void)File;
+	(void)Data;
+	(void)Length;
+	return false;
+#else
+	while( Length != 0 )
+	{
+		const ssize_t Received = read(File, Data, Length);
+		if( Received <= 0 )
+		{
+			return false;
+		}
+		Data += Received;
+		Length -= static_cast<size_t>(Received);
+	}
+	return true;
+#endif
+}
+
+bool WriteAll(int File, const uint8_t *Data, size_t Length)
+{
+#if defined(_WIN32)
+	(void)File;
+	(void)Data;
+	(void)Length;
+	return false;
+#else
+	while( Length != 0 )
+	{
+		const ssize_t Sent = write(File, Data, Length);
+		if( Sent <= 0 )
+		{
+			return false;
+		}
+		Data += Sent;
+		Length -= static_cast<size_t>(Sent);
+	}
+	return true;
+#endif
+}
+
+uint64_t ReadLE(const uint8_t *Data, size_t Bytes)
+{
+	uint64_t Result = 0;
+	for( size_t i = 0; i < Bytes; i++ )
+	{
+		Result |= static_cast<uint64_t>(Data[i]) << (i * 8);
+	}
+	return Result;
+}
+
+void WriteLE(std::vector<uint8_t> &Out, uint64_t Value, size_t Bytes)
+{
+	for( size_t i = 0; i < Bytes; i++ )
+	{
+		Out.push_back(static_cast<uint8_t>(Value >> (i * 8)));
+	}
+}
+}
+
+CommandServer::CommandServer(uint32_t InstructionsPerFrame)
+	:
+	InstructionsPerFrame(std::max<uint32_t>(1, InstructionsPerFrame)),
+	Quit(false)
+{
+}
+
+bool CommandServer::Serve(int In, int Out)
+{
+	std::vector<uint8_t> Request;
+	std::vector<uint8_t> Response;
+	Quit = false;
+	while( !Quit )
+	{
+		uint8_t Length[4];
+		if( !ReadAll(In, Length, sizeof(Length)) )
+		{
+			// End of input between messages is a normal goodbye
+			return true;
+		}
+		const uint32_t Size = static_cast<uint32_t>(ReadLE(Length, 4));
+		if( Size == 0 || Size > MaxMessage )
+		{
+			return false;
+		}
+		Request.resize(Size);
+		if( !ReadAll(In, Request.data(), Size) )
+		{
+			return false;
+		}
+		Response.assign(4, 0);
+		Handle(Request, Response);
+		const uint32_t ResponseSize = static_cast<uint32_t>(Response.size() - 4);
+		for( size_t i = 0; i < 4; i++ )
+		{
+			Response[i] = static_cast<uint8_t>(ResponseSize >> (i * 8));
+		}
+		if( !WriteAll(Out, Response.data(), Response.size()) )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool CommandServer::Listen(const std::string &Path)
+{
+#if defined(_WIN32)
+	(void)Path;
+	return false;
+#else
+	sockaddr_un Address = {};
+	Address.sun_family = AF_UNIX;
+	if( Path.size() >= sizeof(Address.sun_path) )
+	{
+		return false;
+	}
+	std::copy(Path.begin(), Path.end(), Address.sun_path);
+	// A client hanging up mid-response must not take the server down
+	std::signal(SIGPIPE, SIG_IGN);
+	const int Listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if( Listener < 0 )
+	{
+		return false;
+	}
+	unlink(Path.c_str());
+	if(
+		bind(Listener, reinterpret_cast<const sockaddr*>(&Address), sizeof(Address)) != 0
+		|| listen(Listener, 1) != 0
+	)
+	{
+		close(Listener);
+		return false;
+	}
+	Quit = false;
+	while( !Quit )
+	{
+		const int Client = accept(Listener, nullptr, nullptr);
+		if( Client < 0 )
+		{
+			break;
+		}
+		// A client that misbehaves only loses its own connection
+		Serve(Client, Client);
+		close(Client);
+	}
+	close(Listener);
+	unlink(Path.c_str());
+	return Quit;
+#endif
+}
+
+bool CommandServer::Handle(const std::vector<uint8_t> &Request, std::vector<uint8_t> &Response)
+{
+	const uint8_t *Args = Request.data() + 1;
+	const size_t ArgSize = Request.size() - 1;
+	const auto Reply = [&Response](Status Result)
+	{
+		Response.push_back(static_cast<uint8_t>(Result));
+		return Result == Status::Ok;
+	};
+	switch( static_cast<Command>(Request[0]) )
+	{
+	case Command::Load:
+	{
+		Console.Reset();
+		Console.LoadGame(Args, ArgSize);
+		Initial.LoadState(Console);
+		return Reply(Status::Ok);
+	}
+	case Command::Reset:
+	{
+		Console.LoadState(Initial);
+		return Reply(Status::Ok);
+	}
+	case Command::Step:
+	{
+		if( ArgSize != 4 )
+		{
+			return Reply(Status::BadArguments);
+		}
+		// Same spread of each frame over its instructions as the frontend
+		const uint32_t Count = static_cast<uint32_t>(ReadLE(Args, 4));
+		for( uint32_t i = 0; i < Count; i++ )
+		{
+			const uint32_t Slot = static_cast<uint32_t>(Console.GetCycles() % InstructionsPerFrame);
+			Console.Tick(GetTickTime(Slot, InstructionsPerFrame));
+		}
+		Reply(Status::Ok);
+		WriteLE(Response, Console.GetCycles(), 8);
+		return true;
+	}
+	case Command::Keys:
+	{
+		if( ArgSize != 2 )
+		{
+			return Reply(Status::BadArguments);
+		}
+		Console.KeyUp(0xFFFF);
+		Console.KeyDown(static_cast<uint16_t>(ReadLE(Args, 2)));
+		return Reply(Status::Ok);
+	}
+	case Command::Snapshot:
+	case Command::Restore:
+	{
+		if( ArgSize != 4 )
+		{
+			return Reply(Status::BadArguments);
+		}
+		const uint32_t Slot = static_cast<uint32_t>(ReadLE(Args, 4));
+		if( static_cast<Command>(Request[0]) == Command::Snapshot )
+		{
+			// Slots cost a few kilobytes each, so keep clients from asking
+			// for billions of them
+			if( Slot >= 65536 )
+			{
+				return Reply(Status::OutOfRange);
+			}
+			if( Slot >= Slots.size() )
+			{
+				Slots.resize(Slot + 1);
+			}
+			Slots[Slot].LoadState(Console);
+			return Reply(Status::Ok);
+		}
+		if( Slot >= Slots.size() )
+		{
+			return Reply(Status::OutOfRange);
+		}
+		const uint16_t Keys = Console.GetKeys();
+		Console.LoadState(Slots[Slot]);
+		Console.KeyUp(0xFFFF);
+		Console.KeyDown(Keys);
+		return Reply(Status::Ok);
+	}
+	case Command::Screen:
+	{
+		Reply(Status::Ok);
+		const uint8_t *Screen = Console.GetScreen();
+		for( size_t i = 0; i < Chip8::Width * Chip8::Height; i += 8 )
+		{
+			uint8_t Packed = 0;
+			for( size_t Bit = 0; Bit < 8; Bit++ )
+			{
+				Packed = static_cast<uint8_t>((Packed << 1) | (Screen[i + Bit] & 1));
+			}
+			Response.push_back(Packed);
+		}
+		return true;
+	}
+	case Command::Memory:
+	{
+		if( ArgSize != 4 )
+		{
+			return Reply(Status::BadArguments);
+		}
+		const size_t Address = static_cast<size_t>(ReadLE(Args, 2));
+		const size_t Length = static_cast<size_t>(ReadLE(Args + 2, 2));
+		if( Address + Length > 0x1000 )
+		{
+			return Reply(Status::OutOfRange);
+		}
+		Reply(Status::Ok);
+		Response.insert(
+			Response.end(), Console.GetMemory() + Address, Console.GetMemory() + Address + Length
+		);
+		return true;
+	}
+	case Command::Hash:
+	{
+		Reply(Status::Ok);
+		WriteLE(Response, Console.GetStateHash(), 8);
+		return true;
+	}
+	case Command::Quit:
+	{
+		Quit = true;
+		return Reply(Status::Ok);
+	}
+	}
+	return Reply(Status::UnknownCommand);
+}
+}
@@ -0,0 +1,122 @@
+#include "Disassembler.hpp"
+
+#include <stdio.h>
+
+namespace Wunk8
+{
+std::string Disassemble(uint16_t Opcode)
+{
+	const unsigned X = (Opcode >> 8) & 0xF;
+	const unsigned Y = (Opcode >> 4) & 0xF;
+	const unsigned N = Opcode & 0xF;
+	const unsigned NN = Opcode & 0xFF;
+	const unsigned NNN = Opcode & 0xFFF;
+
+	char Text[32];
+	switch( Opcode >> 12 )
+	{
+	case 0x0:
+		if( NNN == 0xE0 )
+		{
+			return "CLS";
+		}
+		if( NNN == 0xEE )
+		{
+			return "RET";
+		}
+		snprintf(Text, sizeof(Text), "SYS 0x%03X", NNN);
+		break;
+	case 0x1:
+		snprintf(Text, sizeof(Text), "JP 0x%03X", NNN);
+		break;
+	case 0x2:
+		snprintf(Text, sizeof(Text), "CALL 0x%03X", NNN);
+		break;
+	case 0x3:
+		snprintf(Text, sizeof(Text), "SE V%X, 0x%02X", X, NN);
+		break;
+	case 0x4:
+		snprintf(Text, sizeof(Text), "SNE V%X, 0x%02X", X, NN);
+		break;
+	case 0x5:
+		snprintf(Text, sizeof(Text), "SE V%X, V%X", X, Y);
+		break;
+	case 0x6:
+		snprintf(Text, sizeof(Text), "LD V%X, 0x%02X", X, NN);
+		break;
+	case 0x7:
+		snprintf(Text, sizeof(Text), "ADD V%X, 0x%02X", X, NN);
+		break;
+	case 0x8:
+	{
+		static const char *Operations[16] =
+		{
+			"LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", "SUBN",
+			nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, "SHL", nullptr
+		};
+		if( Operations[N] == nullptr )
+		{
+			snprintf(Text, sizeof(Text), "DW 0x%04X", Opcode);
+			break;
+		}
+		snprintf(Text, sizeof(Text), "%s V%X, V%X", Operations[N], X, Y);
+		break;
+	}
+	case 0x9:
+		snprintf(Text, sizeof(Text), "SNE V%X, V%X", X, Y);
+		break;
+	case 0xA:
+		snprintf(Text, sizeof(Text), "LD I, 0x%03X", NNN);
+		break;
+	case 0xB:
+		snprintf(Text, sizeof(Text), "JP V0, 0x%03X", NNN);
+		break;
+	case 0xC:
+		snprintf(Text, sizeof(Text), "RND V%X, 0x%02X", X, NN);
+		break;
+	case 0xD:
+		snprintf(Text, sizeof(Text), "DRW V%X, V%X, %u", X, Y, N);
+		break;
+	case 0xE:
+		if( NN == 0x9E )
+		{
+			snprintf(Text, sizeof(Text), "SKP V%X", X);
+		}
+		else if( NN == 0xA1 )
+		{
+			snprintf(Text, sizeof(Text), "SKNP V%X", X);
+		}
+		else
+		{
+			snprintf(Text, sizeof(Text), "DW 0x%04X", Opcode);
+		}
+		break;
+	case 0xF:
+	{
+		const char *Format = nullptr;
+		switch( NN )
+		{
+		case 0x02: Format = "AUDIO"; break;
+		case 0x07: Format = "LD V%X, DT"; break;
+		case 0x0A: Format = "LD V%X, K"; break;
+		case 0x15: Format = "LD DT, V%X"; break;
+		case 0x18: Format = "LD ST, V%X"; break;
+		case 0x1E: Format = "ADD I, V%X"; break;
+		case 0x29: Format = "LD F, V%X"; break;
+		case 0x33: Format = "LD B, V%X"; break;
+		case 0x3A: Format = "PITCH V%X"; break;
+		case 0x55: Format = "LD [I], V%X"; break;
+		case 0x65: Format = "LD V%X, [I]"; break;
+		}
+		if( Format == nullptr )
+		{
+			snprintf(Text, sizeof(Text), "DW 0x%04X", Opcode);
+			break;
+		}
+		snprintf(Text, sizeof(Text), Format, X);
+		break;
+	}
+	}
+	return Text;
+}
+}
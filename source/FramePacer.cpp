@@ -0,0 +1,132 @@
+#include "FramePacer.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace Wunk8
+{
+constexpr uint32_t FramePacer::MaxCatchUpFrames;
+
+FramePacer::FramePacer(std::chrono::microseconds Period)
+	:
+	Period(Period),
+	Speed(1.0),
+	Turbo(false),
+	FrameSkip(0),
+	SpinTail(std::chrono::milliseconds(1))
+{
+	Reset();
+}
+
+void FramePacer::Reset()
+{
+	Deadline = Clock::now();
+	NextTurboPresent = Deadline;
+	CatchUpSkips = 0;
+	Statistics = Stats{
+		0, 0, 0, 0, 0,
+		std::chrono::nanoseconds::zero(), std::chrono::nanoseconds::zero()
+	};
+}
+
+void FramePacer::SetSpeed(double Multiplier)
+{
+	Speed = Multiplier > 0.0 ? Multiplier : 1.0;
+}
+
+void FramePacer::SetTurbo(bool Enabled)
+{
+	if( Turbo && !Enabled )
+	{
+		// Pace from now on rather than from before turbo began
+		Deadline = Clock::now();
+	}
+	Turbo = Enabled;
+}
+
+FramePacer::Clock::duration FramePacer::GetScaledPeriod() const
+{
+	return std::chrono::duration_cast<Clock::duration>(
+		std::chrono::duration<double, std::micro>(Period.count() / Speed)
+	);
+}
+
+bool FramePacer::ShouldPresent()
+{
+	bool Present = true;
+	if( FrameSkip != 0 && Statistics.Frames % (FrameSkip + 1) != 0 )
+	{
+		Present = false;
+	}
+	else if( Turbo )
+	{
+		const Clock::time_point Now = Clock::now();
+		Present = Now >= NextTurboPresent;
+		if( Present )
+		{
+			NextTurboPresent = Now + Period;
+		}
+	}
+	else if( Clock::now() > Deadline + GetScaledPeriod() && CatchUpSkips < MaxCatchUpFrames )
+	{
+		// The next deadline has already passed too, so skip presenting to
+		// catch up. Bounded so a slow host still presents now and then.
+		CatchUpSkips++;
+		Present = false;
+	}
+
+	if( Present )
+	{
+		CatchUpSkips = 0;
+		Statistics.Presented++;
+	}
+	else
+	{
+		Statistics.Skipped++;
+	}
+	return Present;
+}
+
+void FramePacer::Wait()
+{
+	Statistics.Frames++;
+	if( Turbo )
+	{
+		Deadline = Clock::now();
+		return;
+	}
+
+	const Clock::duration ScaledPeriod = GetScaledPeriod();
+	Deadline += ScaledPeriod;
+	Clock::time_point Now = Clock::now();
+	if( Now > Deadline )
+	{
+		Statistics.Late++;
+		if( Now - Deadline > ScaledPeriod * MaxCatchUpFrames )
+		{
+			// Too far behind to catch up, drop the lost time
+			Statistics.Dropped += static_cast<uint64_t>((Now - Deadline) / ScaledPeriod);
+			Deadline = Now;
+		}
+	}
+	else
+	{
+		if( Deadline - Now > SpinTail )
+		{
+			std::this_thread::sleep_until(Deadline - SpinTail);
+		}
+		Now = Clock::now();
+		while( Now < Deadline )
+		{
+			std::this_thread::yield();
+			Now = Clock::now();
+		}
+	}
+
+	const std::chrono::nanoseconds Error = Now - Deadline;
+	Statistics.LastError = Error;
+	Statistics.MaxError = std::max(
+		Statistics.MaxError, Error < Error.zero() ? -Error : Error
+	);
+}
+}
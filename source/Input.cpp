@@ -0,0 +1,333 @@
+#include "Input.hpp"
+#include "Loopback.hpp"
+#include "Replay.hpp"
+#include "Wunk8.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <sstream>
+
+#if !defined(_WIN32)
+#include <sys/socket.h>
+#endif
+
+namespace Wunk8
+{
+int KeypadFromChar(int Char)
+{
+	switch( Char )
+	{
+	case '1': return 0x1;
+	case '2': return 0x2;
+	case '3': return 0x3;
+	case '4': return 0xC;
+	case 'q': return 0x4;
+	case 'w': return 0x5;
+	case 'e': return 0x6;
+	case 'r': return 0xD;
+	case 'a': return 0x7;
+	case 's': return 0x8;
+	case 'd': return 0x9;
+	case 'f': return 0xE;
+	case 'z': return 0xA;
+	case 'x': return 0x0;
+	case 'c': return 0xB;
+	case 'v': return 0xF;
+	default: return -1;
+	}
+}
+
+InputSource::InputSource(bool Live)
+	:
+	Running(false),
+	Live(Live),
+	Finished(false)
+{
+}
+
+InputSource::~InputSource()
+{
+	Stop();
+}
+
+bool InputSource::Push(const InputEvent &Event)
+{
+	while( !Queue.Push(Event) )
+	{
+		if( !Running.load(std::memory_order_relaxed) )
+		{
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return true;
+}
+
+void InputSource::Finish()
+{
+	Finished.store(true, std::memory_order_release);
+}
+
+void InputSource::Stop()
+{
+	Running.store(false);
+	if( Thread.joinable() )
+	{
+		Thread.join();
+	}
+}
+
+InputMux::InputMux()
+	:
+	FramePeriod(std::chrono::steady_clock::duration::zero()),
+	InstructionsPerFrame(0),
+	FrameCycle(0),
+	FrameStart()
+{
+}
+
+void InputMux::AddSource(InputSource &Source)
+{
+	Sources.push_back(&Source);
+}
+
+void InputMux::SetFrameLength(
+	std::chrono::steady_clock::duration Period, uint32_t InstructionsPerFrame
+)
+{
+	FramePeriod = Period;
+	this->InstructionsPerFrame = InstructionsPerFrame;
+}
+
+void InputMux::BeginFrame(uint64_t FrameCycle, std::chrono::steady_clock::time_point FrameStart)
+{
+	this->FrameCycle = FrameCycle;
+	this->FrameStart = FrameStart;
+}
+
+uint64_t InputMux::GetLiveCycle(const InputEvent &Event, uint64_t Now) const
+{
+	if( Event.Time <= FrameStart || FramePeriod <= FramePeriod.zero() )
+	{
+		return Now;
+	}
+	// Emulation runs ahead of the clock, so events arriving during a frame
+	// already emulated land at the start of the next one
+	const uint64_t Offset = static_cast<uint64_t>(
+		(Event.Time - FrameStart) * InstructionsPerFrame / FramePeriod
+	);
+	return std::max(Now, FrameCycle + Offset);
+}
+
+bool InputMux::Record(const std::string &FileName)
+{
+	Recording.open(FileName, std::ios::trunc);
+	return Recording.good();
+}
+
+uint64_t InputMux::Apply(Chip8 &Console)
+{
+	const uint64_t Now = Console.GetCycles();
+	uint64_t Next = std::numeric_limits<uint64_t>::max();
+	for( InputSource *Source : Sources )
+	{
+		InputQueue &Queue = Source->GetQueue();
+		const auto PeekNext = [Source, &Queue]()
+		{
+			const InputEvent *Event = Queue.Peek();
+			// A scripted source may simply not have caught up yet
+			while( Event == nullptr && !Source->IsLive() && !Source->IsFinished() )
+			{
+				std::this_thread::yield();
+				Event = Queue.Peek();
+			}
+			return Event;
+		};
+		const auto GetCycle = [this, Source, Now](const InputEvent &Event)
+		{
+			return Source->IsLive() ? GetLiveCycle(Event, Now) : Event.Cycle;
+		};
+		const InputEvent *Event = PeekNext();
+		while( Event != nullptr && GetCycle(*Event) <= Now )
+		{
+			const uint16_t Key = static_cast<uint16_t>(1 << (Event->Key & 0xF));
+			Event->Pressed ? Console.KeyDown(Key) : Console.KeyUp(Key);
+			if( Recording.is_open() )
+			{
+				WriteReplayLine(Recording, ReplayEvent{ Now, Event->Key, Event->Pressed });
+			}
+			InputEvent Applied;
+			Queue.Pop(Applied);
+			Event = PeekNext();
+		}
+		if( Event != nullptr )
+		{
+			Next = std::min(Next, GetCycle(*Event));
+		}
+	}
+	return Next;
+}
+
+LiveInput::LiveInput()
+	:
+	InputSource(true)
+{
+}
+
+bool LiveInput::Press(uint8_t Key, bool Pressed)
+{
+	return GetQueue().Push(
+		InputEvent{ 0, std::chrono::steady_clock::now(), Key, Pressed }
+	);
+}
+
+ReplayInput::ReplayInput()
+	:
+	InputSource(false)
+{
+}
+
+ReplayInput::~ReplayInput()
+{
+	Stop();
+}
+
+bool ReplayInput::Open(const std::string &FileName)
+{
+	Stop();
+	std::vector<ReplayEvent> Events;
+	if( !ReadReplay(FileName, Events) )
+	{
+		return false;
+	}
+	Running.store(true);
+	// The queue holds only part of a long recording, the rest is pushed as
+	// it drains
+	Thread = std::thread(
+		[this](std::vector<ReplayEvent> Events)
+		{
+			Run(Events);
+		},
+		std::move(Events)
+	);
+	return true;
+}
+
+void ReplayInput::Run(const std::vector<ReplayEvent> &Events)
+{
+	for( const ReplayEvent &Cur : Events )
+	{
+		if( !Push(InputEvent{ Cur.Cycle, {}, Cur.Key, Cur.Pressed }) )
+		{
+			break;
+		}
+	}
+	Finish();
+}
+
+BotInput::BotInput()
+	:
+	InputSource(false)
+{
+}
+
+BotInput::~BotInput()
+{
+	Stop();
+}
+
+void BotInput::Start(uint32_t Seed)
+{
+	Stop();
+	Running.store(true);
+	Thread = std::thread(&BotInput::Run, this, Seed);
+}
+
+void BotInput::Run(uint32_t Seed)
+{
+	// Raw engine output rather than distributions, which differ between
+	// standard libraries
+	std::mt19937 Random(Seed);
+	uint64_t Cycle = 0;
+	while( true )
+	{
+		const uint8_t Key = static_cast<uint8_t>(Random() & 0xF);
+		Cycle += 30 + Random() % 600;
+		if( !Push(InputEvent{ Cycle, {}, Key, true }) )
+		{
+			break;
+		}
+		Cycle += 20 + Random() % 300;
+		if( !Push(InputEvent{ Cycle, {}, Key, false }) )
+		{
+			break;
+		}
+	}
+	Finish();
+}
+
+SocketInput::SocketInput()
+	:
+	InputSource(true),
+	Listener(-1)
+{
+}
+
+SocketInput::~SocketInput()
+{
+	Stop();
+	Loopback::Close(Listener);
+}
+
+bool SocketInput::Start(uint16_t Port)
+{
+	Listener = Loopback::Listen(Port, 1);
+	if( Listener < 0 )
+	{
+		return false;
+	}
+	Running.store(true);
+	Thread = std::thread(&SocketInput::Run, this);
+	return true;
+}
+
+void SocketInput::Run()
+{
+#if !defined(_WIN32)
+	int Client;
+	while( (Client = Loopback::Accept(Listener, Running)) >= 0 )
+	{
+		std::string Pending;
+		char Buffer[256];
+		while( Loopback::WaitReadable(Client, Running) )
+		{
+			const ssize_t Received = recv(Client, Buffer, sizeof(Buffer), 0);
+			if( Received <= 0 )
+			{
+				break;
+			}
+			Pending.append(Buffer, static_cast<size_t>(Received));
+			size_t End;
+			while( (End = Pending.find('\n')) != std::string::npos )
+			{
+				std::istringstream Fields(Pending.substr(0, End));
+				Pending.erase(0, End + 1);
+				std::string State;
+				unsigned Key;
+				if(
+					(Fields >> State >> std::hex >> Key) && Key <= 0xF
+					&& (State == "down" || State == "up")
+				)
+				{
+					Push(InputEvent{
+						0, std::chrono::steady_clock::now(), static_cast<uint8_t>(Key), State == "down"
+					});
+				}
+			}
+		}
+		Loopback::Close(Client);
+	}
+#endif
+}
+}
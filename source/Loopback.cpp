@@ -0,0 +1,92 @@
+#include "Loopback.hpp"
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace Wunk8
+{
+namespace Loopback
+{
+int Listen(uint16_t Port, int Backlog)
+{
+#if defined(_WIN32)
+	(void)Port;
+	(void)Backlog;
+	return -1;
+#else
+	const int Listener = socket(AF_INET, SOCK_STREAM, 0);
+	if( Listener < 0 )
+	{
+		return -1;
+	}
+	const int Reuse = 1;
+	setsockopt(Listener, SOL_SOCKET, SO_REUSEADDR, &Reuse, sizeof(Reuse));
+	sockaddr_in Address = {};
+	Address.sin_family = AF_INET;
+	Address.sin_port = htons(Port);
+	Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if(
+		bind(Listener, reinterpret_cast<const sockaddr*>(&Address), sizeof(Address)) != 0
+		|| listen(Listener, Backlog) != 0
+	)
+	{
+		close(Listener);
+		return -1;
+	}
+	return Listener;
+#endif
+}
+
+int Accept(int Listener, const std::atomic<bool> &Running)
+{
+	while( WaitReadable(Listener, Running) )
+	{
+#if !defined(_WIN32)
+		const int Client = accept(Listener, nullptr, nullptr);
+		if( Client >= 0 )
+		{
+			return Client;
+		}
+#endif
+	}
+	return -1;
+}
+
+bool WaitReadable(int Socket, const std::atomic<bool> &Running)
+{
+#if defined(_WIN32)
+	(void)Socket;
+	(void)Running;
+	return false;
+#else
+	while( Running.load(std::memory_order_relaxed) )
+	{
+		// Wake up regularly to notice Running being cleared
+		pollfd Waiting = { Socket, POLLIN, 0 };
+		if( poll(&Waiting, 1, 100) > 0 )
+		{
+			return true;
+		}
+	}
+	return false;
+#endif
+}
+
+void Close(int Socket)
+{
+#if !defined(_WIN32)
+	if( Socket >= 0 )
+	{
+		close(Socket);
+	}
+#else
+	(void)Socket;
+#endif
+}
+}
+}
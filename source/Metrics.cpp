@@ -0,0 +1,261 @@
+#include "Metrics.hpp"
+#include "Loopback.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if !defined(_WIN32)
+#include <poll.h>
+#include <sys/socket.h>
+#endif
+
+namespace Wunk8
+{
+namespace Metrics
+{
+constexpr size_t Histogram::BucketCount;
+
+Histogram::Histogram()
+	:
+	Count(0),
+	Sum(0),
+	Max(0)
+{
+	for( std::atomic<uint64_t> &Bucket : Buckets )
+	{
+		Bucket.store(0, std::memory_order_relaxed);
+	}
+}
+
+uint64_t Histogram::BucketUpperBound(size_t Index)
+{
+	if( Index < 32 )
+	{
+		return Index;
+	}
+	const size_t Magnitude = 5 + (Index - 32) / 16;
+	const uint64_t Top = 16 + (Index - 32) % 16;
+	return ((Top + 1) << (Magnitude - 4)) - 1;
+}
+
+uint64_t Histogram::GetQuantile(double Quantile) const
+{
+	const uint64_t Total = GetCount();
+	if( Total == 0 )
+	{
+		return 0;
+	}
+	const uint64_t Target = std::max<uint64_t>(
+		static_cast<uint64_t>(Quantile * Total + 0.5), 1
+	);
+	uint64_t Seen = 0;
+	for( size_t i = 0; i < BucketCount; i++ )
+	{
+		Seen += Buckets[i].load(std::memory_order_relaxed);
+		if( Seen >= Target )
+		{
+			return std::min(BucketUpperBound(i), GetMax());
+		}
+	}
+	return GetMax();
+}
+
+Counter& Registry::AddCounter(const std::string &Name, const std::string &Help)
+{
+	Entries.push_back(Entry{ Name, Help, nullptr, nullptr, nullptr });
+	Entries.back().AsCounter.reset(new Counter());
+	return *Entries.back().AsCounter;
+}
+
+Gauge& Registry::AddGauge(const std::string &Name, const std::string &Help)
+{
+	Entries.push_back(Entry{ Name, Help, nullptr, nullptr, nullptr });
+	Entries.back().AsGauge.reset(new Gauge());
+	return *Entries.back().AsGauge;
+}
+
+Histogram& Registry::AddHistogram(const std::string &Name, const std::string &Help)
+{
+	Entries.push_back(Entry{ Name, Help, nullptr, nullptr, nullptr });
+	Entries.back().AsHistogram.reset(new Histogram());
+	return *Entries.back().AsHistogram;
+}
+
+std::string Registry::Render() const
+{
+	std::ostringstream Out;
+	for( const Entry &Cur : Entries )
+	{
+		Out << "# HELP " << Cur.Name << ' ' << Cur.Help << '\n';
+		if( Cur.AsCounter )
+		{
+			Out << "# TYPE " << Cur.Name << " counter\n";
+			Out << Cur.Name << ' ' << Cur.AsCounter->Get() << '\n';
+		}
+		else if( Cur.AsGauge )
+		{
+			Out << "# TYPE " << Cur.Name << " gauge\n";
+			Out << Cur.Name << ' ' << Cur.AsGauge->Get() << '\n';
+		}
+		else if( Cur.AsHistogram )
+		{
+			Out << "# TYPE " << Cur.Name << " summary\n";
+			for( const char *Quantile : { "0.5", "0.9", "0.99", "0.999" } )
+			{
+				Out << Cur.Name << "{quantile=\"" << Quantile << "\"} "
+					<< Cur.AsHistogram->GetQuantile(atof(Quantile)) << '\n';
+			}
+			Out << Cur.Name << "{quantile=\"1\"} " << Cur.AsHistogram->GetMax() << '\n';
+			Out << Cur.Name << "_sum " << Cur.AsHistogram->GetSum() << '\n';
+			Out << Cur.Name << "_count " << Cur.AsHistogram->GetCount() << '\n';
+		}
+	}
+	return Out.str();
+}
+
+Server::Server(const Registry &Source)
+	:
+	Source(Source),
+	Listener(-1),
+	Running(false)
+{
+}
+
+Server::~Server()
+{
+	Stop();
+}
+
+bool Server::Start(uint16_t Port)
+{
+	Stop();
+	Listener = Loopback::Listen(Port, 4);
+	if( Listener < 0 )
+	{
+		return false;
+	}
+	Running.store(true);
+	Thread = std::thread(&Server::Run, this);
+	return true;
+}
+
+void Server::Stop()
+{
+	Running.store(false);
+	if( Thread.joinable() )
+	{
+		Thread.join();
+	}
+	Loopback::Close(Listener);
+	Listener = -1;
+}
+
+void Server::Run()
+{
+#if !defined(_WIN32)
+	int Client;
+	while( (Client = Loopback::Accept(Listener, Running)) >= 0 )
+	{
+		// Any request gets the metrics, only wait briefly for it to arrive
+		char Request[1024];
+		pollfd Reading = { Client, POLLIN, 0 };
+		if( poll(&Reading, 1, 100) > 0 )
+		{
+			if( recv(Client, Request, sizeof(Request), 0) < 0 )
+			{
+				Loopback::Close(Client);
+				continue;
+			}
+		}
+		const std::string Body = Source.Render();
+		const std::string Response =
+			"HTTP/1.0 200 OK\r\n"
+			"Content-Type: text/plain; version=0.0.4\r\n"
+			"Content-Length: " + std::to_string(Body.size()) + "\r\n"
+			"Connection: close\r\n\r\n" + Body;
+		size_t Sent = 0;
+		while( Sent < Response.size() )
+		{
+			const ssize_t Result = send(
+				Client, Response.data() + Sent, Response.size() - Sent, MSG_NOSIGNAL
+			);
+			if( Result <= 0 )
+			{
+				break;
+			}
+			Sent += static_cast<size_t>(Result);
+		}
+		Loopback::Close(Client);
+	}
+#endif
+}
+
+FileWriter::FileWriter(const Registry &Source, const std::string &FileName)
+	:
+	Source(Source),
+	FileName(FileName),
+	Running(false)
+{
+}
+
+FileWriter::~FileWriter()
+{
+	Stop();
+}
+
+void FileWriter::Start(std::chrono::milliseconds Interval)
+{
+	Stop();
+	Running.store(true);
+	Thread = std::thread(&FileWriter::Run, this, Interval);
+}
+
+void FileWriter::Stop()
+{
+	Running.store(false);
+	if( Thread.joinable() )
+	{
+		Thread.join();
+	}
+}
+
+bool FileWriter::WriteNow() const
+{
+	// Write aside and rename over the old file, which replaces it atomically
+	const std::string TempName = FileName + ".tmp";
+	{
+		std::ofstream Out(TempName, std::ios::trunc);
+		Out << Source.Render();
+		if( !Out.good() )
+		{
+			return false;
+		}
+	}
+#if defined(_WIN32)
+	remove(FileName.c_str());
+#endif
+	return rename(TempName.c_str(), FileName.c_str()) == 0;
+}
+
+void FileWriter::Run(std::chrono::milliseconds Interval)
+{
+	auto Deadline = std::chrono::steady_clock::now();
+	while( Running.load(std::memory_order_relaxed) )
+	{
+		WriteNow();
+		Deadline += Interval;
+		while(
+			Running.load(std::memory_order_relaxed)
+			&& std::chrono::steady_clock::now() < Deadline
+		)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		}
+	}
+	WriteNow();
+}
+}
+}
@@ -0,0 +1,264 @@
+#include "PerfCounters.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <iomanip>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+#endif
+
+namespace Wunk8
+{
+#if defined(__linux__)
+namespace
+{
+int OpenEvent(uint32_t Type, uint64_t Config, int GroupFd)
+{
+	perf_event_attr Attributes;
+	memset(&Attributes, 0, sizeof(Attributes));
+	Attributes.size = sizeof(Attributes);
+	Attributes.type = Type;
+	Attributes.config = Config;
+	Attributes.exclude_kernel = 1;
+	Attributes.exclude_hv = 1;
+	Attributes.read_format = PERF_FORMAT_GROUP
+		| PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return static_cast<int>(
+		syscall(__NR_perf_event_open, &Attributes, 0, -1, GroupFd, 0)
+	);
+}
+}
+#endif
+
+PerfCounters::PerfCounters()
+	:
+	Leader(-1),
+	Opened(0)
+{
+	std::fill(std::begin(Descriptors), std::end(Descriptors), -1);
+	std::fill(std::begin(ReadIndex), std::end(ReadIndex), -1);
+	std::fill(std::begin(BatchStart), std::end(BatchStart), 0);
+	Reset();
+}
+
+PerfCounters::~PerfCounters()
+{
+	Close();
+}
+
+bool PerfCounters::Open()
+{
+	Close();
+#if defined(__linux__)
+	const struct
+	{
+		uint32_t Type;
+		uint64_t Config;
+	} Events[EventCount] =
+	{
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+		{
+			PERF_TYPE_HW_CACHE,
+			PERF_COUNT_HW_CACHE_L1D
+				| (PERF_COUNT_HW_CACHE_OP_READ << 8)
+				| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+		}
+	};
+	// All events share one group so they are scheduled together and
+	// read with a single call
+	for( size_t i = 0; i < EventCount; i++ )
+	{
+		const int Descriptor = OpenEvent(Events[i].Type, Events[i].Config, Leader);
+		if( Descriptor < 0 )
+		{
+			continue;
+		}
+		if( Leader < 0 )
+		{
+			Leader = Descriptor;
+		}
+		Descriptors[i] = Descriptor;
+		ReadIndex[i] = static_cast<int>(Opened++);
+	}
+	if( Leader >= 0 )
+	{
+		ioctl(Leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(Leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	}
+	for( size_t i = 0; i < EventCount; i++ )
+	{
+		Totals.Valid[i] = ReadIndex[i] >= 0;
+	}
+#endif
+	return IsOpen();
+}
+
+void PerfCounters::Close()
+{
+#if defined(__linux__)
+	// Members before the leader
+	for( size_t i = EventCount; i-- > 0; )
+	{
+		if( Descriptors[i] >= 0 )
+		{
+			close(Descriptors[i]);
+		}
+	}
+#endif
+	std::fill(std::begin(Descriptors), std::end(Descriptors), -1);
+	std::fill(std::begin(ReadIndex), std::end(ReadIndex), -1);
+	Leader = -1;
+	Opened = 0;
+}
+
+bool PerfCounters::ReadCounters(uint64_t (&Values)[EventCount])
+{
+#if defined(__linux__)
+	// nr, time enabled, time running, values[nr]
+	uint64_t Buffer[3 + EventCount];
+	const ssize_t Expected = static_cast<ssize_t>((3 + Opened) * sizeof(uint64_t));
+	if( read(Leader, Buffer, sizeof(Buffer)) != Expected )
+	{
+		return false;
+	}
+	// Scale up when the kernel had to multiplex the counters
+	const double Scale = Buffer[2] ?
+		static_cast<double>(Buffer[1]) / Buffer[2] : 1.0;
+	for( size_t i = 0; i < EventCount; i++ )
+	{
+		Values[i] = ReadIndex[i] >= 0 ?
+			static_cast<uint64_t>(Buffer[3 + ReadIndex[i]] * Scale) : 0;
+	}
+	return true;
+#else
+	(void)Values;
+	return false;
+#endif
+}
+
+void PerfCounters::Begin()
+{
+	if( IsOpen() && !ReadCounters(BatchStart) )
+	{
+		std::fill(std::begin(BatchStart), std::end(BatchStart), 0);
+	}
+}
+
+void PerfCounters::End(uint64_t EmulatedInstructions)
+{
+	uint64_t BatchEnd[EventCount];
+	if( !IsOpen() || !ReadCounters(BatchEnd) )
+	{
+		return;
+	}
+	Totals.Emulated += EmulatedInstructions;
+	for( size_t i = 0; i < EventCount; i++ )
+	{
+		if( BatchEnd[i] > BatchStart[i] )
+		{
+			Totals.Counts[i] += BatchEnd[i] - BatchStart[i];
+		}
+	}
+}
+
+void PerfCounters::Reset()
+{
+	Totals.Emulated = 0;
+	std::fill(std::begin(Totals.Counts), std::end(Totals.Counts), 0);
+	for( size_t i = 0; i < EventCount; i++ )
+	{
+		Totals.Valid[i] = ReadIndex[i] >= 0;
+	}
+}
+
+const char* PerfCounters::EventName(Event Type)
+{
+	switch( Type )
+	{
+	case Instructions:
+		return "instructions";
+	case Cycles:
+		return "cycles";
+	case BranchMisses:
+		return "branch-misses";
+	case L1DMisses:
+		return "L1-dcache-load-misses";
+	case EventCount:
+		break;
+	}
+	return "unknown";
+}
+
+void PerfCounters::WriteReport(std::ostream &Out, const Profiler *Prof) const
+{
+	Out << "Host counters over " << Totals.Emulated << " emulated instructions:\n";
+	const std::ios::fmtflags Flags = Out.flags();
+	Out << std::fixed << std::setprecision(2);
+	for( size_t i = 0; i < EventCount; i++ )
+	{
+		const Event Type = static_cast<Event>(i);
+		Out << "  " << std::setw(22) << std::left << EventName(Type) << std::right;
+		if( !Totals.Valid[i] )
+		{
+			Out << "unsupported\n";
+			continue;
+		}
+		Out << std::setw(16) << Totals.Counts[i]
+			<< std::setw(12) << Totals.PerInstruction(Type) << " per instruction\n";
+	}
+
+	if( Prof == nullptr || Totals.Emulated == 0 )
+	{
+		Out.flags(Flags);
+		return;
+	}
+
+	double SampledTotal = 0.0;
+	for( uint8_t Class = 0; Class < 16; Class++ )
+	{
+		SampledTotal += Prof->GetClassCycles(Class);
+	}
+	if( SampledTotal <= 0.0 )
+	{
+		Out.flags(Flags);
+		return;
+	}
+	Out << "Per instruction of each opcode class(by share of sampled time):\n";
+	Out << "  class ";
+	for( size_t i = 0; i < EventCount; i++ )
+	{
+		if( Totals.Valid[i] )
+		{
+			Out << std::setw(23) << EventName(static_cast<Event>(i));
+		}
+	}
+	Out << '\n';
+	for( uint8_t Class = 0; Class < 16; Class++ )
+	{
+		const uint64_t ClassCount = Prof->GetClassCount(Class);
+		if( ClassCount == 0 )
+		{
+			continue;
+		}
+		const double Share = Prof->GetClassCycles(Class) / SampledTotal;
+		Out << "  " << std::setw(5) << std::left << Profiler::ClassName(Class) << std::right << ' ';
+		for( size_t i = 0; i < EventCount; i++ )
+		{
+			if( Totals.Valid[i] )
+			{
+				Out << std::setw(23) << Totals.Counts[i] * Share / ClassCount;
+			}
+		}
+		Out << '\n';
+	}
+	Out.flags(Flags);
+}
+}
@@ -0,0 +1,204 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+#include <stdio.h>
+
+namespace Wunk8
+{
+Profiler::Profiler(uint32_t SampleInterval)
+	:
+	SampleInterval(std::max<uint32_t>(SampleInterval, 1))
+{
+	Reset();
+}
+
+void Profiler::Reset()
+{
+	Countdown = SampleInterval;
+	Sampling = false;
+	SampleStart = 0;
+	CurClass = CurSubOp = 0;
+	std::fill(&Counts[0][0], &Counts[0][0] + 16 * 256, 0);
+	std::fill(&SampledCounts[0][0], &SampledCounts[0][0] + 16 * 256, 0);
+	std::fill(&SampledCycles[0][0], &SampledCycles[0][0] + 16 * 256, 0);
+	std::fill(std::begin(PCHits), std::end(PCHits), 0);
+	std::fill(std::begin(SpriteHeights), std::end(SpriteHeights), 0);
+	std::fill(std::begin(SpriteCollisions), std::end(SpriteCollisions), 0);
+}
+
+uint64_t Profiler::GetClassCount(uint8_t Class) const
+{
+	uint64_t Total = 0;
+	for( size_t i = 0; i < 256; i++ )
+	{
+		Total += Counts[Class & 0xF][i];
+	}
+	return Total;
+}
+
+double Profiler::EstimatedCycles(uint8_t Class, uint8_t SubOp) const
+{
+	if( SampledCounts[Class][SubOp] == 0 )
+	{
+		return 0.0;
+	}
+	return static_cast<double>(SampledCycles[Class][SubOp])
+		* Counts[Class][SubOp] / SampledCounts[Class][SubOp];
+}
+
+double Profiler::GetClassCycles(uint8_t Class) const
+{
+	double Total = 0.0;
+	for( size_t i = 0; i < 256; i++ )
+	{
+		Total += EstimatedCycles(Class & 0xF, static_cast<uint8_t>(i));
+	}
+	return Total;
+}
+
+const char* Profiler::ClassName(uint8_t Class)
+{
+	static const char *Names[16] =
+	{
+		"SYS", "JP", "CALL", "SE", "SNE", "SER", "LD", "ADD",
+		"ALU", "SNER", "LDI", "JPV0", "RND", "DRW", "SKP", "MISC"
+	};
+	return Names[Class & 0xF];
+}
+
+std::string Profiler::SubOpName(uint8_t Class, uint8_t SubOp)
+{
+	char Name[8];
+	switch( Class & 0xF )
+	{
+	case 0x0:
+		if( SubOp == 0xE0 || SubOp == 0xEE )
+		{
+			snprintf(Name, sizeof(Name), "00%02X", SubOp);
+			return Name;
+		}
+		return "0NNN";
+	case 0x8:
+		snprintf(Name, sizeof(Name), "8XY%X", SubOp & 0xF);
+		return Name;
+	case 0xE:
+	case 0xF:
+		snprintf(Name, sizeof(Name), "%XX%02X", Class & 0xF, SubOp);
+		return Name;
+	}
+	static const char *Patterns[16] =
+	{
+		"0NNN", "1NNN", "2NNN", "3XNN", "4XNN", "5XY0", "6XNN", "7XNN",
+		"8XYN", "9XY0", "ANNN", "BNNN", "CXNN", "DXYN", "EXNN", "FXNN"
+	};
+	return Patterns[Class & 0xF];
+}
+
+void Profiler::WriteJson(std::ostream &Out) const
+{
+	uint64_t Total = 0;
+	for( uint8_t Class = 0; Class < 16; Class++ )
+	{
+		Total += GetClassCount(Class);
+	}
+
+	Out << "{\n\t\"instructions\": " << Total << ",\n";
+	Out << "\t\"sample_interval\": " << SampleInterval << ",\n";
+
+	Out << "\t\"classes\": [";
+	bool FirstClass = true;
+	for( uint8_t Class = 0; Class < 16; Class++ )
+	{
+		const uint64_t ClassCount = GetClassCount(Class);
+		if( ClassCount == 0 )
+		{
+			continue;
+		}
+		Out << (FirstClass ? "\n" : ",\n");
+		FirstClass = false;
+		Out << "\t\t{ \"class\": \"" << ClassName(Class) << "\", \"count\": "
+			<< ClassCount << ", \"cycles\": "
+			<< static_cast<uint64_t>(GetClassCycles(Class)) << ", \"subops\": [";
+		bool FirstSubOp = true;
+		for( size_t i = 0; i < 256; i++ )
+		{
+			if( Counts[Class][i] == 0 )
+			{
+				continue;
+			}
+			Out << (FirstSubOp ? " " : ", ");
+			FirstSubOp = false;
+			Out << "{ \"op\": \"" << SubOpName(Class, static_cast<uint8_t>(i))
+				<< "\", \"count\": " << Counts[Class][i] << ", \"cycles\": "
+				<< static_cast<uint64_t>(EstimatedCycles(Class, static_cast<uint8_t>(i)))
+				<< " }";
+		}
+		Out << " ] }";
+	}
+	Out << "\n\t],\n";
+
+	// Most executed addresses first
+	std::vector<uint16_t> HotPCs;
+	for( uint16_t PC = 0; PC < 0x1000; PC++ )
+	{
+		if( PCHits[PC] )
+		{
+			HotPCs.push_back(PC);
+		}
+	}
+	const size_t HotCount = std::min<size_t>(HotPCs.size(), 32);
+	std::partial_sort(
+		HotPCs.begin(), HotPCs.begin() + HotCount, HotPCs.end(),
+		[this](uint16_t A, uint16_t B)
+		{
+			return PCHits[A] > PCHits[B];
+		}
+	);
+	Out << "\t\"hot_pcs\": [";
+	for( size_t i = 0; i < HotCount; i++ )
+	{
+		char Address[8];
+		snprintf(Address, sizeof(Address), "0x%03X", HotPCs[i]);
+		Out << (i ? ", " : " ") << "{ \"pc\": \"" << Address
+			<< "\", \"count\": " << PCHits[HotPCs[i]] << " }";
+	}
+	Out << " ],\n";
+
+	Out << "\t\"sprites\": [";
+	bool FirstSprite = true;
+	for( size_t Height = 0; Height < 16; Height++ )
+	{
+		if( SpriteHeights[Height] == 0 )
+		{
+			continue;
+		}
+		Out << (FirstSprite ? " " : ", ");
+		FirstSprite = false;
+		Out << "{ \"height\": " << Height << ", \"count\": " << SpriteHeights[Height]
+			<< ", \"collisions\": " << SpriteCollisions[Height] << " }";
+	}
+	Out << " ]\n}\n";
+}
+
+void Profiler::WriteFolded(std::ostream &Out) const
+{
+	for( uint8_t Class = 0; Class < 16; Class++ )
+	{
+		for( size_t i = 0; i < 256; i++ )
+		{
+			if( Counts[Class][i] == 0 )
+			{
+				continue;
+			}
+			// Sub-ops that were never sampled still show up with a weight of 1
+			const uint64_t Weight = std::max<uint64_t>(
+				static_cast<uint64_t>(EstimatedCycles(Class, static_cast<uint8_t>(i))), 1
+			);
+			Out << "Chip8;" << ClassName(Class) << ';'
+				<< SubOpName(Class, static_cast<uint8_t>(i)) << ' ' << Weight << '\n';
+		}
+	}
+}
+}
@@ -0,0 +1,56 @@
+#include "Replay.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace Wunk8
+{
+bool ParseReplayLine(const std::string &Line, ReplayEvent &Event)
+{
+	if( Line.empty() || Line[0] == '#' )
+	{
+		return false;
+	}
+	std::istringstream Fields(Line);
+	unsigned long long Cycle;
+	unsigned Key;
+	std::string State;
+	if( !(Fields >> Cycle >> std::hex >> Key >> State) || Key > 0xF )
+	{
+		return false;
+	}
+	Event = ReplayEvent{ Cycle, static_cast<uint8_t>(Key), State == "down" };
+	return true;
+}
+
+void WriteReplayLine(std::ostream &Stream, const ReplayEvent &Event)
+{
+	Stream
+		<< Event.Cycle << ' ' << std::hex << (Event.Key & 0xF) << std::dec
+		<< (Event.Pressed ? " down\n" : " up\n");
+}
+
+bool ReadReplay(const std::string &FileName, std::vector<ReplayEvent> &Events)
+{
+	std::ifstream File(FileName);
+	if( !File.good() )
+	{
+		return false;
+	}
+	std::string Line;
+	ReplayEvent Cur;
+	while( std::getline(File, Line) )
+	{
+		if( ParseReplayLine(Line, Cur) )
+		{
+			Events.push_back(Cur);
+		}
+	}
+	std::stable_sort(
+		Events.begin(), Events.end(),
+		[](const ReplayEvent &A, const ReplayEvent &B) { return A.Cycle < B.Cycle; }
+	);
+	return true;
+}
+}
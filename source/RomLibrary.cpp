@@ -0,0 +1,442 @@
+#include "RomLibrary.hpp"
+#include "Wunk8.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <string.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace Wunk8
+{
+namespace
+{
+// Pack file layout:
+// PackHeader
+// PackEntry[Count]
+// Program data, each program starting at its entry's Offset
+struct PackHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint32_t Count;
+	uint32_t Reserved;
+};
+
+struct PackEntry
+{
+	uint64_t Hash;
+	uint32_t Offset;
+	uint32_t Length;
+	uint8_t Quirks;
+	uint8_t Reserved;
+	uint16_t Speed;
+	char Name[RomLibrary::MaxPackName];
+};
+
+static_assert(sizeof(PackHeader) == 16, "Unexpected pack header size");
+static_assert(sizeof(PackEntry) == 64, "Unexpected pack entry size");
+
+constexpr char PackMagic[4] = { 'W', '8', 'R', 'P' };
+constexpr uint32_t PackVersion = 1;
+
+const char *ManifestName = "manifest.txt";
+
+// Largest program that fits in memory after the interpreter area
+constexpr size_t MaxRomLength = 0x1000 - 0x200;
+
+#if defined(MAP_POPULATE)
+constexpr int MapFlags = MAP_PRIVATE | MAP_POPULATE;
+#elif !defined(_WIN32)
+constexpr int MapFlags = MAP_PRIVATE;
+#endif
+}
+
+constexpr uint16_t RomLibrary::DefaultSpeed;
+constexpr size_t RomLibrary::MaxPackName;
+
+RomLibrary::RomLibrary()
+{
+}
+
+RomLibrary::~RomLibrary()
+{
+	Close();
+}
+
+bool RomLibrary::Open(const std::string &Path)
+{
+	Close();
+#if defined(_WIN32)
+	const DWORD Attributes = GetFileAttributesA(Path.c_str());
+	if( Attributes == INVALID_FILE_ATTRIBUTES )
+	{
+		return false;
+	}
+	const bool IsDirectory = (Attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+	struct stat Status;
+	if( stat(Path.c_str(), &Status) != 0 )
+	{
+		return false;
+	}
+	const bool IsDirectory = S_ISDIR(Status.st_mode);
+#endif
+	const bool Result = IsDirectory ? OpenDirectory(Path) : OpenPack(Path);
+	if( !Result )
+	{
+		Close();
+	}
+	return Result;
+}
+
+void RomLibrary::Close()
+{
+	for( const Mapping &CurMapping : Mappings )
+	{
+#if defined(_WIN32)
+		UnmapViewOfFile(CurMapping.Base);
+		CloseHandle(CurMapping.Section);
+		CloseHandle(CurMapping.File);
+#else
+		munmap(CurMapping.Base, CurMapping.Length);
+#endif
+	}
+	Mappings.clear();
+	Entries.clear();
+	HashIndex.clear();
+}
+
+bool RomLibrary::OpenDirectory(const std::string &Path)
+{
+	std::vector<std::string> FileNames;
+#if defined(_WIN32)
+	WIN32_FIND_DATAA FindData;
+	HANDLE Find = FindFirstFileA((Path + "\\*").c_str(), &FindData);
+	if( Find == INVALID_HANDLE_VALUE )
+	{
+		return false;
+	}
+	do
+	{
+		if( !(FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) )
+		{
+			FileNames.emplace_back(FindData.cFileName);
+		}
+	} while( FindNextFileA(Find, &FindData) );
+	FindClose(Find);
+#else
+	DIR *Directory = opendir(Path.c_str());
+	if( Directory == nullptr )
+	{
+		return false;
+	}
+	while( const dirent *DirEntry = readdir(Directory) )
+	{
+		if( DirEntry->d_name[0] != '.' )
+		{
+			FileNames.emplace_back(DirEntry->d_name);
+		}
+	}
+	closedir(Directory);
+#endif
+	// Keep indexing order stable across hosts
+	std::sort(FileNames.begin(), FileNames.end());
+
+	// Optional per-file metadata
+	std::unordered_map<std::string, Metadata> Manifest;
+	std::ifstream ManifestFile(Path + '/' + ManifestName);
+	std::string Line;
+	while( std::getline(ManifestFile, Line) )
+	{
+		if( Line.empty() || Line[0] == '#' )
+		{
+			continue;
+		}
+		std::istringstream Fields(Line);
+		std::string Name, Profile;
+		unsigned Speed = DefaultSpeed;
+		Metadata Meta = { QuirkProfile::Chip8, DefaultSpeed };
+		if( !(Fields >> Name >> Profile)
+			|| !ParseQuirkProfile(Profile, Meta.Quirks) )
+		{
+			continue;
+		}
+		if( Fields >> Speed && Speed )
+		{
+			Meta.Speed = static_cast<uint16_t>(std::min(Speed, 0xFFFFu));
+		}
+		Manifest[Name] = Meta;
+	}
+
+	for( const std::string &FileName : FileNames )
+	{
+		if( FileName == ManifestName )
+		{
+			continue;
+		}
+		size_t Length;
+		const uint8_t *Data = MapFile(Path + '/' + FileName, Length);
+		if( Data == nullptr )
+		{
+			continue;
+		}
+		Entry Rom;
+		Rom.Name = FileName;
+		Rom.Data = Data;
+		Rom.Length = std::min(Length, MaxRomLength);
+		Rom.Hash = HashRom(Rom.Data, Rom.Length);
+		const auto Found = Manifest.find(FileName);
+		Rom.Meta = Found != Manifest.end() ?
+			Found->second : Metadata{ QuirkProfile::Chip8, DefaultSpeed };
+		AddEntry(std::move(Rom));
+	}
+	return true;
+}
+
+bool RomLibrary::OpenPack(const std::string &FileName)
+{
+	size_t Length;
+	const uint8_t *Data = MapFile(FileName, Length);
+	if( Data == nullptr || Length < sizeof(PackHeader) )
+	{
+		return false;
+	}
+
+	PackHeader Header;
+	memcpy(&Header, Data, sizeof(PackHeader));
+	if( memcmp(Header.Magic, PackMagic, sizeof(PackMagic)) != 0
+		|| Header.Version != PackVersion
+		|| Header.Count > (Length - sizeof(PackHeader)) / sizeof(PackEntry) )
+	{
+		return false;
+	}
+
+	const uint8_t *EntryData = Data + sizeof(PackHeader);
+	for( size_t i = 0; i < Header.Count; i++ )
+	{
+		PackEntry CurEntry;
+		memcpy(&CurEntry, EntryData + i * sizeof(PackEntry), sizeof(PackEntry));
+		if( CurEntry.Offset > Length
+			|| CurEntry.Length > Length - CurEntry.Offset
+			|| CurEntry.Length > MaxRomLength )
+		{
+			return false;
+		}
+		Entry Rom;
+		Rom.Name.assign(
+			CurEntry.Name,
+			strnlen(CurEntry.Name, sizeof(CurEntry.Name))
+		);
+		Rom.Data = Data + CurEntry.Offset;
+		Rom.Length = CurEntry.Length;
+		// Lookups trust the hash, so a damaged pack must not get that far
+		Rom.Hash = HashRom(Rom.Data, Rom.Length);
+		if( Rom.Hash != CurEntry.Hash )
+		{
+			return false;
+		}
+		Rom.Meta.Quirks = static_cast<QuirkProfile>(CurEntry.Quirks);
+		Rom.Meta.Speed = CurEntry.Speed ? CurEntry.Speed : DefaultSpeed;
+		AddEntry(std::move(Rom));
+	}
+	return true;
+}
+
+const uint8_t* RomLibrary::MapFile(const std::string &FileName, size_t &Length)
+{
+	Mapping NewMapping;
+#if defined(_WIN32)
+	NewMapping.File = CreateFileA(
+		FileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+	);
+	if( NewMapping.File == INVALID_HANDLE_VALUE )
+	{
+		return nullptr;
+	}
+	LARGE_INTEGER FileSize;
+	if( !GetFileSizeEx(NewMapping.File, &FileSize) || FileSize.QuadPart == 0 )
+	{
+		CloseHandle(NewMapping.File);
+		return nullptr;
+	}
+	NewMapping.Length = static_cast<size_t>(FileSize.QuadPart);
+	NewMapping.Section = CreateFileMappingA(
+		NewMapping.File, nullptr, PAGE_READONLY, 0, 0, nullptr
+	);
+	if( NewMapping.Section == nullptr )
+	{
+		CloseHandle(NewMapping.File);
+		return nullptr;
+	}
+	NewMapping.Base = MapViewOfFile(NewMapping.Section, FILE_MAP_READ, 0, 0, 0);
+	if( NewMapping.Base == nullptr )
+	{
+		CloseHandle(NewMapping.Section);
+		CloseHandle(NewMapping.File);
+		return nullptr;
+	}
+#else
+	const int File = open(FileName.c_str(), O_RDONLY);
+	if( File < 0 )
+	{
+		return nullptr;
+	}
+	struct stat Status;
+	if( fstat(File, &Status) != 0 || !S_ISREG(Status.st_mode) || Status.st_size == 0 )
+	{
+		close(File);
+		return nullptr;
+	}
+	NewMapping.Length = static_cast<size_t>(Status.st_size);
+	NewMapping.Base = mmap(
+		nullptr, NewMapping.Length, PROT_READ, MapFlags, File, 0
+	);
+	// The mapping keeps its own reference to the file
+	close(File);
+	if( NewMapping.Base == MAP_FAILED )
+	{
+		return nullptr;
+	}
+#endif
+	Mappings.push_back(NewMapping);
+	Length = NewMapping.Length;
+	return static_cast<const uint8_t*>(NewMapping.Base);
+}
+
+void RomLibrary::AddEntry(Entry &&Rom)
+{
+	// Identical programs under different names share the first entry
+	if( HashIndex.emplace(Rom.Hash, Entries.size()).second )
+	{
+		Entries.push_back(std::move(Rom));
+	}
+}
+
+bool RomLibrary::WritePack(const std::string &FileName) const
+{
+	// Truncated names could collide in the name lookup
+	for( const Entry &Rom : Entries )
+	{
+		if( Rom.Name.size() > MaxPackName )
+		{
+			return false;
+		}
+	}
+
+	std::ofstream fOut(FileName, std::ios::binary | std::ios::trunc);
+	if( !fOut.good() )
+	{
+		return false;
+	}
+
+	PackHeader Header;
+	memcpy(Header.Magic, PackMagic, sizeof(PackMagic));
+	Header.Version = PackVersion;
+	Header.Count = static_cast<uint32_t>(Entries.size());
+	Header.Reserved = 0;
+	fOut.write(reinterpret_cast<const char*>(&Header), sizeof(PackHeader));
+
+	uint32_t Offset = static_cast<uint32_t>(
+		sizeof(PackHeader) + Entries.size() * sizeof(PackEntry)
+	);
+	for( const Entry &Rom : Entries )
+	{
+		PackEntry CurEntry = {};
+		CurEntry.Hash = Rom.Hash;
+		CurEntry.Offset = Offset;
+		CurEntry.Length = static_cast<uint32_t>(Rom.Length);
+		CurEntry.Quirks = static_cast<uint8_t>(Rom.Meta.Quirks);
+		CurEntry.Speed = Rom.Meta.Speed;
+		Rom.Name.copy(CurEntry.Name, sizeof(CurEntry.Name));
+		fOut.write(reinterpret_cast<const char*>(&CurEntry), sizeof(PackEntry));
+		Offset += CurEntry.Length;
+	}
+	for( const Entry &Rom : Entries )
+	{
+		fOut.write(reinterpret_cast<const char*>(Rom.Data), Rom.Length);
+	}
+	return fOut.good();
+}
+
+const RomLibrary::Entry* RomLibrary::Find(uint64_t Hash) const
+{
+	const auto Found = HashIndex.find(Hash);
+	return Found != HashIndex.end() ? &Entries[Found->second] : nullptr;
+}
+
+const RomLibrary::Entry* RomLibrary::Find(const std::string &Name) const
+{
+	for( const Entry &Rom : Entries )
+	{
+		if( Rom.Name == Name )
+		{
+			return &Rom;
+		}
+	}
+	return nullptr;
+}
+
+bool RomLibrary::Load(Chip8 &Console, const Entry &Rom)
+{
+	Console.Reset();
+	return Console.LoadGame(Rom.Data, Rom.Length);
+}
+
+bool RomLibrary::Load(Chip8 &Console, uint64_t Hash) const
+{
+	const Entry *Rom = Find(Hash);
+	return Rom != nullptr && Load(Console, *Rom);
+}
+
+uint64_t RomLibrary::HashRom(const void *Data, size_t Length)
+{
+	const uint8_t *Bytes = static_cast<const uint8_t*>(Data);
+	uint64_t Hash = 0xCBF29CE484222325ull;
+	for( size_t i = 0; i < Length; i++ )
+	{
+		Hash ^= Bytes[i];
+		Hash *= 0x100000001B3ull;
+	}
+	return Hash;
+}
+
+const char* RomLibrary::QuirkProfileName(QuirkProfile Profile)
+{
+	switch( Profile )
+	{
+	case QuirkProfile::Chip8:
+		return "chip8";
+	case QuirkProfile::SuperChip:
+		return "schip";
+	case QuirkProfile::XOChip:
+		return "xochip";
+	}
+	return "unknown";
+}
+
+bool RomLibrary::ParseQuirkProfile(const std::string &Name, QuirkProfile &Profile)
+{
+	for( const QuirkProfile Candidate :
+		{ QuirkProfile::Chip8, QuirkProfile::SuperChip, QuirkProfile::XOChip } )
+	{
+		if( Name == QuirkProfileName(Candidate) )
+		{
+			Profile = Candidate;
+			return true;
+		}
+	}
+	return false;
+}
+}
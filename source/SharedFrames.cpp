@@ -0,0 +1,230 @@
+#include "SharedFrames.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Wunk8
+{
+namespace SharedFrames
+{
+namespace
+{
+// A slot takes well under a microsecond to write, so one that stays busy
+// this long belongs to a writer that died while publishing it
+constexpr uint32_t MaxReadAttempts = 1000;
+
+Slot* GetSlots(Header *Ring)
+{
+	return reinterpret_cast<Slot*>(Ring + 1);
+}
+
+const Slot* GetSlots(const Header *Ring)
+{
+	return reinterpret_cast<const Slot*>(Ring + 1);
+}
+}
+
+size_t GetSize(uint32_t SlotCount)
+{
+	return sizeof(Header) + sizeof(Slot) * SlotCount;
+}
+
+Writer::Writer()
+	:
+	Ring(nullptr),
+	Size(0),
+	NextFrame(0)
+{
+}
+
+Writer::~Writer()
+{
+	Close();
+}
+
+bool Writer::Open(const std::string &Name, uint32_t SlotCount)
+{
+	Close();
+#if defined(_WIN32)
+	(void)Name;
+	(void)SlotCount;
+	return false;
+#else
+	if( SlotCount == 0 )
+	{
+		return false;
+	}
+	// Start over so readers of an older ring never see a size change
+	shm_unlink(Name.c_str());
+	const int File = shm_open(Name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if( File < 0 )
+	{
+		return false;
+	}
+	Size = GetSize(SlotCount);
+	void *Mapped = MAP_FAILED;
+	if( ftruncate(File, static_cast<off_t>(Size)) == 0 )
+	{
+		Mapped = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_SHARED, File, 0);
+	}
+	close(File);
+	if( Mapped == MAP_FAILED )
+	{
+		shm_unlink(Name.c_str());
+		return false;
+	}
+	this->Name = Name;
+	// ftruncate zero-fills, leaving every sequence even and the ring empty
+	Ring = static_cast<Header*>(Mapped);
+	std::copy_n(Magic, sizeof(Magic), Ring->Magic);
+	Ring->SlotCount = SlotCount;
+	Ring->Width = Chip8::Width;
+	Ring->Height = Chip8::Height;
+	Ring->Published.store(0, std::memory_order_relaxed);
+	NextFrame = 0;
+	// Readers check the version last, after the rest of the header
+	std::atomic_thread_fence(std::memory_order_release);
+	Ring->Version = Version;
+	return true;
+#endif
+}
+
+void Writer::Close()
+{
+#if !defined(_WIN32)
+	if( Ring != nullptr )
+	{
+		munmap(Ring, Size);
+		shm_unlink(Name.c_str());
+		Ring = nullptr;
+	}
+#endif
+}
+
+void Writer::Publish(const Chip8 &Console)
+{
+	if( Ring == nullptr )
+	{
+		return;
+	}
+	Slot &Cur = GetSlots(Ring)[NextFrame % Ring->SlotCount];
+	const uint64_t Sequence = Cur.Sequence.load(std::memory_order_relaxed);
+	Cur.Sequence.store(Sequence + 1, std::memory_order_relaxed);
+	// Keep the writes below from moving ahead of the odd sequence
+	std::atomic_thread_fence(std::memory_order_release);
+	Cur.Frame = NextFrame;
+	Cur.Cycles = Console.GetCycles();
+	Cur.StateHash = Console.GetStateHash();
+	std::copy_n(Console.GetScreen(), sizeof(Cur.Screen), Cur.Screen);
+	Cur.Sequence.store(Sequence + 2, std::memory_order_release);
+	NextFrame++;
+	Ring->Published.store(NextFrame, std::memory_order_release);
+}
+
+Reader::Reader()
+	:
+	Ring(nullptr),
+	Size(0)
+{
+}
+
+Reader::~Reader()
+{
+	Close();
+}
+
+bool Reader::Open(const std::string &Name)
+{
+	Close();
+#if defined(_WIN32)
+	(void)Name;
+	return false;
+#else
+	const int File = shm_open(Name.c_str(), O_RDONLY, 0);
+	if( File < 0 )
+	{
+		return false;
+	}
+	struct stat Info;
+	void *Mapped = MAP_FAILED;
+	if( fstat(File, &Info) == 0 && static_cast<size_t>(Info.st_size) >= sizeof(Header) )
+	{
+		Size = static_cast<size_t>(Info.st_size);
+		Mapped = mmap(nullptr, Size, PROT_READ, MAP_SHARED, File, 0);
+	}
+	close(File);
+	if( Mapped == MAP_FAILED )
+	{
+		return false;
+	}
+	Ring = static_cast<const Header*>(Mapped);
+	const uint32_t FoundVersion = Ring->Version;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if(
+		FoundVersion != Version
+		|| !std::equal(Magic, Magic + sizeof(Magic), Ring->Magic)
+		|| Ring->Width != Chip8::Width || Ring->Height != Chip8::Height
+		|| Ring->SlotCount == 0 || GetSize(Ring->SlotCount) > Size
+	)
+	{
+		Close();
+		return false;
+	}
+	return true;
+#endif
+}
+
+void Reader::Close()
+{
+#if !defined(_WIN32)
+	if( Ring != nullptr )
+	{
+		munmap(const_cast<Header*>(Ring), Size);
+		Ring = nullptr;
+	}
+#endif
+}
+
+uint64_t Reader::GetPublished() const
+{
+	return Ring ? Ring->Published.load(std::memory_order_acquire) : 0;
+}
+
+bool Reader::Read(uint64_t Number, CopiedFrame &Result) const
+{
+	if( Ring == nullptr || Number >= GetPublished() )
+	{
+		return false;
+	}
+	const Slot &Cur = GetSlots(Ring)[Number % Ring->SlotCount];
+	for( uint32_t Attempt = 0; Attempt < MaxReadAttempts; Attempt++ )
+	{
+		const uint64_t Before = Cur.Sequence.load(std::memory_order_acquire);
+		if( Before & 1 )
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		Result.Frame = Cur.Frame;
+		Result.Cycles = Cur.Cycles;
+		Result.StateHash = Cur.StateHash;
+		std::copy_n(Cur.Screen, sizeof(Cur.Screen), Result.Screen);
+		// Keep the reads above from moving past the second sequence load
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if( Cur.Sequence.load(std::memory_order_relaxed) == Before )
+		{
+			// The slot may hold a newer frame by now
+			return Result.Frame == Number;
+		}
+	}
+	return false;
+}
+}
+}
@@ -0,0 +1,143 @@
+#include "TerminalRenderer.hpp"
+#include "Wunk8.hpp"
+
+#include <algorithm>
+
+#if defined(_WIN32)
+#include <io.h>
+#define write _write
+#else
+#include <unistd.h>
+#endif
+
+namespace Wunk8
+{
+TerminalRenderer::TerminalRenderer(Mode CellMode, int FileDescriptor)
+	:
+	CellMode(CellMode),
+	FileDescriptor(FileDescriptor),
+	CellsWide(CellMode == Mode::Braille ? Chip8::Width / 2 : Chip8::Width),
+	CellsHigh(CellMode == Mode::Braille ? Chip8::Height / 4 : Chip8::Height / 2),
+	FullRedraw(true),
+	LastFrameSize(0)
+{
+	std::fill(std::begin(Cells), std::end(Cells), 0);
+	// Worst case of a cursor move and a 3-byte glyph for every cell
+	Output.reserve(CellsWide * CellsHigh * 12 + 64);
+
+	// Clear the terminal and hide the cursor
+	Output = "\x1B[2J\x1B[?25l";
+	Flush();
+}
+
+TerminalRenderer::~TerminalRenderer()
+{
+	// Move below the display and restore the cursor
+	Output = "\x1B[" + std::to_string(CellsHigh + 1) + ";1H\x1B[?25h";
+	Flush();
+}
+
+uint8_t TerminalRenderer::CellBits(
+	const uint8_t *Screen, size_t CellX, size_t CellY
+) const
+{
+	if( CellMode == Mode::HalfBlock )
+	{
+		const uint8_t *Top = Screen + (CellY * 2) * Chip8::Width + CellX;
+		return (Top[0] ? 1 : 0) | (Top[Chip8::Width] ? 2 : 0);
+	}
+
+	// Braille dot numbering:
+	// 0x01 0x08
+	// 0x02 0x10
+	// 0x04 0x20
+	// 0x40 0x80
+	static constexpr uint8_t DotBits[4][2] =
+	{
+		{ 0x01, 0x08 },
+		{ 0x02, 0x10 },
+		{ 0x04, 0x20 },
+		{ 0x40, 0x80 }
+	};
+	const uint8_t *Origin = Screen + (CellY * 4) * Chip8::Width + CellX * 2;
+	uint8_t Bits = 0;
+	for( size_t Y = 0; Y < 4; Y++ )
+	{
+		for( size_t X = 0; X < 2; X++ )
+		{
+			Bits |= Origin[Y * Chip8::Width + X] ? DotBits[Y][X] : 0;
+		}
+	}
+	return Bits;
+}
+
+void TerminalRenderer::AppendGlyph(uint8_t Bits)
+{
+	if( CellMode == Mode::HalfBlock )
+	{
+		// ' ', U+2580 upper half, U+2584 lower half, U+2588 full block
+		static const char *Glyphs[4] =
+		{
+			" ", "\xE2\x96\x80", "\xE2\x96\x84", "\xE2\x96\x88"
+		};
+		Output += Glyphs[Bits & 3];
+		return;
+	}
+	// U+2800 + Bits
+	Output += '\xE2';
+	Output += static_cast<char>(0xA0 | (Bits >> 6));
+	Output += static_cast<char>(0x80 | (Bits & 0x3F));
+}
+
+void TerminalRenderer::Draw(const uint8_t *Screen)
+{
+	Output.clear();
+	for( size_t CellY = 0; CellY < CellsHigh; CellY++ )
+	{
+		// Column the terminal cursor sits at after the last glyph, if any
+		size_t CursorX = CellsWide + 1;
+		for( size_t CellX = 0; CellX < CellsWide; CellX++ )
+		{
+			const uint8_t Bits = CellBits(Screen, CellX, CellY);
+			uint8_t &Previous = Cells[CellY * CellsWide + CellX];
+			if( Bits == Previous && !FullRedraw )
+			{
+				continue;
+			}
+			Previous = Bits;
+			// Runs of changed cells only need a single cursor move
+			if( CursorX != CellX )
+			{
+				Output += "\x1B[";
+				Output += std::to_string(CellY + 1);
+				Output += ';';
+				Output += std::to_string(CellX + 1);
+				Output += 'H';
+			}
+			AppendGlyph(Bits);
+			CursorX = CellX + 1;
+		}
+	}
+	FullRedraw = false;
+	LastFrameSize = Output.size();
+	Flush();
+}
+
+void TerminalRenderer::Flush()
+{
+	const char *Data = Output.data();
+	size_t Remaining = Output.size();
+	while( Remaining )
+	{
+		const auto Written = write(
+			FileDescriptor, Data, static_cast<unsigned>(Remaining)
+		);
+		if( Written <= 0 )
+		{
+			break;
+		}
+		Data += Written;
+		Remaining -= static_cast<size_t>(Written);
+	}
+}
+}
@@ -0,0 +1,178 @@
+#include "Timeline.hpp"
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Wunk8
+{
+namespace Timeline
+{
+std::atomic<bool> Enabled(false);
+
+namespace
+{
+// Written by its owning thread only. Count is published with release
+// ordering after each event so Write can read without locking.
+struct ThreadBuffer
+{
+	uint32_t ThreadId;
+	std::string Name;
+	std::atomic<size_t> Count;
+	std::atomic<uint64_t> Dropped;
+	std::unique_ptr<Event[]> Events;
+};
+
+std::mutex RegistryLock;
+// Buffers outlive their threads so nothing is lost once a thread exits
+std::vector<std::unique_ptr<ThreadBuffer>> Registry;
+std::chrono::steady_clock::time_point Epoch = std::chrono::steady_clock::now();
+
+ThreadBuffer& GetThreadBuffer()
+{
+	thread_local ThreadBuffer *Buffer = nullptr;
+	if( Buffer == nullptr )
+	{
+		std::unique_ptr<ThreadBuffer> NewBuffer(new ThreadBuffer());
+		NewBuffer->Count.store(0, std::memory_order_relaxed);
+		NewBuffer->Dropped.store(0, std::memory_order_relaxed);
+		NewBuffer->Events.reset(new Event[ThreadCapacity]);
+
+		const std::lock_guard<std::mutex> Lock(RegistryLock);
+		NewBuffer->ThreadId = static_cast<uint32_t>(Registry.size() + 1);
+		Buffer = NewBuffer.get();
+		Registry.push_back(std::move(NewBuffer));
+	}
+	return *Buffer;
+}
+}
+
+void Start()
+{
+	{
+		const std::lock_guard<std::mutex> Lock(RegistryLock);
+		Epoch = std::chrono::steady_clock::now();
+		for( const auto &Buffer : Registry )
+		{
+			Buffer->Count.store(0, std::memory_order_relaxed);
+			Buffer->Dropped.store(0, std::memory_order_relaxed);
+		}
+	}
+	Enabled.store(true, std::memory_order_release);
+}
+
+void Stop()
+{
+	Enabled.store(false, std::memory_order_release);
+}
+
+uint64_t Now()
+{
+	return static_cast<uint64_t>(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - Epoch
+		).count()
+	);
+}
+
+void Record(const char *Name, uint64_t Begin, uint64_t End)
+{
+	ThreadBuffer &Buffer = GetThreadBuffer();
+	const size_t Index = Buffer.Count.load(std::memory_order_relaxed);
+	if( Index >= ThreadCapacity )
+	{
+		Buffer.Dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	Buffer.Events[Index] = { Name, Begin, End > Begin ? End - Begin : 0 };
+	Buffer.Count.store(Index + 1, std::memory_order_release);
+}
+
+void SetThreadName(const char *Name)
+{
+	ThreadBuffer &Buffer = GetThreadBuffer();
+	const std::lock_guard<std::mutex> Lock(RegistryLock);
+	Buffer.Name = Name;
+}
+
+uint64_t GetDropped()
+{
+	const std::lock_guard<std::mutex> Lock(RegistryLock);
+	uint64_t Dropped = 0;
+	for( const auto &Buffer : Registry )
+	{
+		Dropped += Buffer->Dropped.load(std::memory_order_relaxed);
+	}
+	return Dropped;
+}
+
+namespace
+{
+void WriteString(std::ostream &Out, const char *String)
+{
+	Out << '"';
+	for( ; *String; String++ )
+	{
+		if( *String == '"' || *String == '\\' )
+		{
+			Out << '\\';
+		}
+		Out << *String;
+	}
+	Out << '"';
+}
+
+// Chrome trace timestamps are in microseconds
+void WriteMicroseconds(std::ostream &Out, uint64_t Nanoseconds)
+{
+	const uint64_t Fraction = Nanoseconds % 1000;
+	Out << Nanoseconds / 1000 << '.'
+		<< static_cast<char>('0' + Fraction / 100)
+		<< static_cast<char>('0' + Fraction / 10 % 10)
+		<< static_cast<char>('0' + Fraction % 10);
+}
+}
+
+bool Write(const std::string &FileName)
+{
+	std::ofstream Out(FileName);
+	if( !Out.good() )
+	{
+		return false;
+	}
+
+	const std::lock_guard<std::mutex> Lock(RegistryLock);
+	Out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool First = true;
+	for( const auto &Buffer : Registry )
+	{
+		if( !Buffer->Name.empty() )
+		{
+			Out << (First ? "" : ",\n")
+				<< "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+				<< Buffer->ThreadId << ",\"args\":{\"name\":";
+			WriteString(Out, Buffer->Name.c_str());
+			Out << "}}";
+			First = false;
+		}
+		const size_t Count = Buffer->Count.load(std::memory_order_acquire);
+		for( size_t i = 0; i < Count; i++ )
+		{
+			const Event &Cur = Buffer->Events[i];
+			Out << (First ? "" : ",\n") << "{\"name\":";
+			WriteString(Out, Cur.Name);
+			Out << ",\"cat\":\"wunk8\",\"ph\":\"X\",\"pid\":1,\"tid\":" << Buffer->ThreadId
+				<< ",\"ts\":";
+			WriteMicroseconds(Out, Cur.Begin);
+			Out << ",\"dur\":";
+			WriteMicroseconds(Out, Cur.Duration);
+			Out << '}';
+			First = false;
+		}
+	}
+	Out << "\n]}\n";
+	return Out.good();
+}
+}
+}
@@ -0,0 +1,134 @@
+#include "Tracer.hpp"
+
+#include <signal.h>
+#include <fcntl.h>
+
+#if defined(_WIN32)
+#include <io.h>
+#define open _open
+#define write _write
+#define close _close
+#else
+#include <unistd.h>
+#endif
+
+#if !defined(O_BINARY)
+#define O_BINARY 0
+#endif
+
+namespace Wunk8
+{
+constexpr char Tracer::Magic[4];
+constexpr uint32_t Tracer::Version;
+constexpr uint8_t Tracer::NoRegister;
+
+namespace
+{
+const Tracer *CrashTracer = nullptr;
+char CrashFileName[4096];
+
+const int CrashSignals[] = {
+	SIGSEGV, SIGILL, SIGFPE, SIGABRT,
+#if defined(SIGBUS)
+	SIGBUS
+#endif
+};
+
+bool WriteAll(int File, const void *Data, size_t Length)
+{
+	const char *Bytes = static_cast<const char*>(Data);
+	while( Length )
+	{
+		const auto Written = write(File, Bytes, static_cast<unsigned>(Length));
+		if( Written <= 0 )
+		{
+			return false;
+		}
+		Bytes += Written;
+		Length -= static_cast<size_t>(Written);
+	}
+	return true;
+}
+}
+
+Tracer::Tracer(size_t Capacity)
+	:
+	Capacity(1),
+	Written(0)
+{
+	while( this->Capacity < Capacity )
+	{
+		this->Capacity <<= 1;
+	}
+	Mask = this->Capacity - 1;
+	Records.reset(new TraceRecord[this->Capacity]);
+}
+
+Tracer::~Tracer()
+{
+	if( CrashTracer == this )
+	{
+		RemoveCrashHandler();
+	}
+}
+
+bool Tracer::Flush(const char *FileName) const
+{
+	return WriteFile(FileName);
+}
+
+bool Tracer::WriteFile(const char *FileName) const
+{
+	const int File = open(FileName, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+	if( File < 0 )
+	{
+		return false;
+	}
+	const size_t Count = GetCount();
+	TraceHeader Header;
+	memcpy(Header.Magic, Magic, sizeof(Magic));
+	Header.Version = Version;
+	Header.RecordSize = sizeof(TraceRecord);
+	Header.Count = static_cast<uint32_t>(Count);
+
+	// The oldest record sits right after the newest once the ring wrapped
+	const size_t Oldest = static_cast<size_t>((Written - Count) & Mask);
+	const size_t FirstPart = Count < Capacity - Oldest ? Count : Capacity - Oldest;
+	const bool Result = WriteAll(File, &Header, sizeof(Header))
+		&& WriteAll(File, &Records[Oldest], FirstPart * sizeof(TraceRecord))
+		&& WriteAll(File, &Records[0], (Count - FirstPart) * sizeof(TraceRecord));
+	close(File);
+	return Result;
+}
+
+void Tracer::InstallCrashHandler(const char *FileName)
+{
+	strncpy(CrashFileName, FileName, sizeof(CrashFileName) - 1);
+	CrashFileName[sizeof(CrashFileName) - 1] = '\0';
+	CrashTracer = this;
+	for( const int Signal : CrashSignals )
+	{
+		signal(Signal, OnCrash);
+	}
+}
+
+void Tracer::RemoveCrashHandler()
+{
+	for( const int Signal : CrashSignals )
+	{
+		signal(Signal, SIG_DFL);
+	}
+	CrashTracer = nullptr;
+}
+
+void Tracer::OnCrash(int Signal)
+{
+	if( CrashTracer )
+	{
+		CrashTracer->WriteFile(CrashFileName);
+	}
+	// Let the default action produce the usual exit status or core dump
+	signal(Signal, SIG_DFL);
+	raise(Signal);
+}
+}
@@ -0,0 +1,97 @@
+#include "TransitionCache.hpp"
+
+namespace Wunk8
+{
+TransitionCache::TransitionCache(
+	size_t Capacity,
+	uint32_t InstructionsPerFrame,
+	std::chrono::microseconds FramePeriod
+)
+	:
+	InstructionsPerFrame(InstructionsPerFrame),
+	FramePeriod(FramePeriod),
+	Mask(0),
+	Counters{ 0, 0, 0, 0 }
+{
+	size_t Size = 1;
+	while( Size < Capacity )
+	{
+		Size <<= 1;
+	}
+	Entries.resize(Size);
+	Mask = Size - 1;
+	Clear();
+}
+
+void TransitionCache::Clear()
+{
+	for( Entry &Cur : Entries )
+	{
+		Cur.Key = 0;
+	}
+}
+
+uint64_t TransitionCache::GetKey(const Chip8 &Console, uint32_t Slot, uint32_t Count) const
+{
+	// SplitMix64 finalizer over the run's position and length, so that runs
+	// from the same state do not collide
+	uint64_t Run = (static_cast<uint64_t>(Slot) << 32 | Count) + 0x9E3779B97F4A7C15;
+	Run = (Run ^ (Run >> 30)) * 0xBF58476D1CE4E5B9;
+	Run = (Run ^ (Run >> 27)) * 0x94D049BB133111EB;
+	Run ^= Run >> 31;
+	const uint64_t Key = Console.GetStateHash() ^ Run;
+	return Key == 0 ? 1 : Key;
+}
+
+bool TransitionCache::Run(Chip8 &Console, uint32_t Slot, uint32_t Count)
+{
+	if( Count == 0 )
+	{
+		return true;
+	}
+	const uint64_t Key = GetKey(Console, Slot, Count);
+	Entry &Found = Entries[Key & Mask];
+	if( Found.Key == Key )
+	{
+		// The keyboard, cycle count and attachments stay the console's own
+		const uint16_t KeyStates = Console.Keyboard.KeyStates;
+		const uint64_t Cycles = Console.Cycles;
+		const uint32_t Seed = Console.Seed;
+		const bool DeltaFrame = Console.DeltaFrame;
+		Console.LoadState(Found.After);
+		Console.Keyboard.KeyStates = KeyStates;
+		Console.Cycles = Cycles + Count;
+		Console.Seed = Seed;
+		Console.DeltaFrame = DeltaFrame || Found.Drew;
+		Console.KeyRead = false;
+		Counters.Hits++;
+		Counters.Skipped += Count;
+		return true;
+	}
+
+	const bool DeltaFrame = Console.DeltaFrame;
+	Console.DeltaFrame = false;
+	Console.KeyRead = false;
+	for( uint32_t i = Slot; i < Slot + Count; i++ )
+	{
+		const uint32_t Frame = i % InstructionsPerFrame;
+		if( !Console.Tick(GetTickTime(Frame, InstructionsPerFrame, FramePeriod)) )
+		{
+			Console.DeltaFrame = DeltaFrame || Console.DeltaFrame;
+			return false;
+		}
+	}
+	const bool Drew = Console.DeltaFrame;
+	Console.DeltaFrame = DeltaFrame || Drew;
+	if( Console.KeyRead )
+	{
+		Counters.Bypassed++;
+		return true;
+	}
+	Found.Key = Key;
+	Found.Drew = Drew;
+	Found.After.LoadState(Console);
+	Counters.Misses++;
+	return true;
+}
+}
@@ -0,0 +1,120 @@
+#include "VectorEnv.hpp"
+
+#include <algorithm>
+
+namespace Wunk8
+{
+VectorEnv::VectorEnv(size_t Count, uint32_t InstructionsPerFrame, uint32_t Seed)
+	:
+	InstructionsPerFrame(std::max<uint32_t>(1, InstructionsPerFrame)),
+	ObservationSize(ScreenObservationSize)
+{
+	Consoles.reserve(Count);
+	for( size_t i = 0; i < Count; i++ )
+	{
+		Consoles.emplace_back(static_cast<uint32_t>(Seed + i));
+	}
+	Initial = Consoles;
+}
+
+bool VectorEnv::LoadGame(const void *Data, size_t Length)
+{
+	for( size_t i = 0; i < Consoles.size(); i++ )
+	{
+		Chip8 &Console = Initial[i];
+		Console.Reset();
+		if( !Console.LoadGame(Data, Length) )
+		{
+			return false;
+		}
+	}
+	ResetAll();
+	return true;
+}
+
+void VectorEnv::Reset(size_t Index)
+{
+	Consoles[Index].LoadState(Initial[Index]);
+}
+
+void VectorEnv::ResetAll()
+{
+	for( size_t i = 0; i < Consoles.size(); i++ )
+	{
+		Reset(i);
+	}
+}
+
+void VectorEnv::ObserveScreen()
+{
+	Addresses.clear();
+	ObservationSize = ScreenObservationSize;
+}
+
+void VectorEnv::ObserveMemory(const uint16_t *Addresses, size_t Count)
+{
+	this->Addresses.assign(Addresses, Addresses + Count);
+	for( uint16_t &Address : this->Addresses )
+	{
+		Address &= 0xFFF;
+	}
+	ObservationSize = Count;
+}
+
+void VectorEnv::Step(const uint16_t *Keys, const uint32_t *Frames, uint8_t *Observations)
+{
+	for( size_t i = 0; i < Consoles.size(); i++ )
+	{
+		Chip8 &Console = Consoles[i];
+		if( Keys )
+		{
+			Console.KeyUp(0xFFFF);
+			Console.KeyDown(Keys[i]);
+		}
+		const uint32_t FrameCount = Frames ? Frames[i] : 1;
+		for( uint32_t Frame = 0; Frame < FrameCount; Frame++ )
+		{
+			for( uint32_t Slot = 0; Slot < InstructionsPerFrame; Slot++ )
+			{
+				Console.Tick(GetTickTime(Slot, InstructionsPerFrame));
+			}
+		}
+		if( Observations )
+		{
+			Observe(i, Observations + i * ObservationSize);
+		}
+	}
+}
+
+void VectorEnv::Observe(uint8_t *Observations) const
+{
+	for( size_t i = 0; i < Consoles.size(); i++ )
+	{
+		Observe(i, Observations + i * ObservationSize);
+	}
+}
+
+void VectorEnv::Observe(size_t Index, uint8_t *Observation) const
+{
+	const Chip8 &Console = Consoles[Index];
+	if( !Addresses.empty() || ObservationSize == 0 )
+	{
+		const uint8_t *Memory = Console.GetMemory();
+		for( size_t i = 0; i < Addresses.size(); i++ )
+		{
+			Observation[i] = Memory[Addresses[i]];
+		}
+		return;
+	}
+	const uint8_t *Screen = Console.GetScreen();
+	for( size_t i = 0; i < ScreenObservationSize; i++ )
+	{
+		uint8_t Packed = 0;
+		for( size_t Bit = 0; Bit < 8; Bit++ )
+		{
+			Packed = static_cast<uint8_t>((Packed << 1) | (Screen[i * 8 + Bit] & 1));
+		}
+		Observation[i] = Packed;
+	}
+}
+}
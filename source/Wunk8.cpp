@@ -2,67 +2,21 @@
 
 #include <fstream>
 #include <algorithm>
+#include <type_traits>
 
 namespace Wunk8
 {
-Chip8::Chip8(uint32_t Seed)
-	:
-	Seed(Seed),
-	RandEng(Seed)
-{
-	Reset();
-}
-
-Chip8::~Chip8()
-{
-}
+static_assert(
+	std::is_trivially_copyable<Chip8>::value,
+	"Snapshots rely on Chip8 being plain data"
+);
+static_assert(
+	Chip8().GetPC() == 0x200,
+	"Boot images rely on Chip8 being usable in constant expressions"
+);
 
-void Chip8::Reset()
-{
-	// Ram/Rom
-	std::fill(std::begin(Memory.Data), std::end(Memory.Data), 0);
-
-	// Load FontSet into memory
-	static constexpr uint8_t Chip8Font[] =
-	{
-		0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
-		0x20, 0x60, 0x20, 0x20, 0x70, // 1
-		0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
-		0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
-		0x90, 0x90, 0xF0, 0x10, 0x10, // 4
-		0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
-		0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
-		0xF0, 0x10, 0x20, 0x40, 0x40, // 7
-		0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
-		0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
-		0xF0, 0x90, 0xF0, 0x90, 0x90, // A
-		0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
-		0xF0, 0x80, 0x80, 0x80, 0xF0, // C
-		0xE0, 0x90, 0x90, 0x90, 0xE0, // D
-		0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
-		0xF0, 0x80, 0xF0, 0x80, 0x80  // F
-	};
-	std::copy_n(
-		std::begin(Chip8Font),
-		sizeof(Chip8Font),
-		std::begin(Memory.Data));
-
-	// Registers
-	// Program counter starts at 0x200
-	Registers = { { 0 }, 0, 0x200, 0 };
-
-	// Stack
-	std::fill(std::begin(Stack), std::end(Stack), 0);
-
-	// Display
-	std::fill(
-		std::begin(Display.Screen),
-		std::end(Display.Screen),
-		0);
-
-	Timer.Delay = Timer.Sound = 0;
-	Keyboard.KeyStates = 0;
-}
+constexpr uint8_t Chip8::Font[16 * 5];
+constexpr uint64_t Chip8::PowerOn::MemoryHash;
 
 bool Chip8::LoadGame(const std::string &FileName)
 {
@@ -75,15 +29,13 @@ bool Chip8::LoadGame(const std::string &FileName)
 
 		if( fIn.good() )
 		{
+			uint8_t Program[sizeof(Memory.Data) - 0x200];
 			size_t Length = static_cast<size_t>(fIn.tellg());
-			Length = std::min(sizeof(Memory.Data) - 0x200, Length);
+			Length = std::min(sizeof(Program), Length);
 			fIn.seekg(0, std::ios::beg);
-			fIn.read(
-				reinterpret_cast<char*>(Memory.Data) + 0x200,
-				Length
-			);
+			fIn.read(reinterpret_cast<char*>(Program), Length);
 			fIn.close();
-			return true;
+			return LoadGame(Program, Length);
 		}
 	}
 	return false;
@@ -91,285 +43,159 @@ bool Chip8::LoadGame(const std::string &FileName)
 
 bool Chip8::LoadGame(const void *Data, size_t Length)
 {
-	if( Data )
-	{
-		std::copy_n(
-			static_cast<const uint8_t*>(Data),
-			Length,
-			std::begin(Memory.Data) + 0x200
-		);
-	}
+	return LoadGame(static_cast<const uint8_t*>(Data), Length);
+}
+
+bool Chip8::Tick(const std::chrono::microseconds DeltaTime)
+{
+	return Execute(DeltaTime);
+}
+
+void Chip8::LoadState(const Chip8 &Snapshot)
+{
+#if defined(WUNK8_PROFILE)
+	Profiler *const CurProf = Prof;
+#endif
+#if defined(WUNK8_TRACE)
+	Tracer *const CurTrace = Trace;
+#endif
+	*this = Snapshot;
+#if defined(WUNK8_PROFILE)
+	Prof = CurProf;
+#endif
+#if defined(WUNK8_TRACE)
+	Trace = CurTrace;
+#endif
+}
+
+namespace
+{
+struct StateFileHeader
+{
+	char Magic[4];
+	uint32_t Size;
+};
+constexpr char StateFileMagic[4] = { 'W', '8', 'S', 'T' };
+}
+
+bool Chip8::SaveStateFile(const std::string &FileName) const
+{
+	// Copy into an instance without a profiler or tracer so no host
+	// pointers end up in the file
+	Chip8 Snapshot;
+	Snapshot.LoadState(*this);
+	StateFileHeader Header;
+	std::copy_n(StateFileMagic, 4, Header.Magic);
+	Header.Size = sizeof(Chip8);
+
+	std::ofstream fOut(FileName, std::ios::binary | std::ios::trunc);
+	fOut.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+	fOut.write(reinterpret_cast<const char*>(&Snapshot), sizeof(Chip8));
+	return fOut.good();
+}
+
+bool Chip8::LoadStateFile(const std::string &FileName)
+{
+	std::ifstream fIn(FileName, std::ios::binary);
+	StateFileHeader Header;
+	Chip8 Snapshot;
+	if(
+		!fIn.read(reinterpret_cast<char*>(&Header), sizeof(Header))
+		|| !std::equal(StateFileMagic, StateFileMagic + 4, Header.Magic)
+		|| Header.Size != sizeof(Chip8)
+		|| !fIn.read(reinterpret_cast<char*>(&Snapshot), sizeof(Chip8))
+	)
+	{
+		return false;
+	}
+	LoadState(Snapshot);
 	return true;
 }
 
-bool Chip8::Tick(const std::chrono::milliseconds DeltaTime)
+uint64_t Chip8::ComputeScreenHash() const
 {
-	uint16_t Opcode = Memory.Data[Registers.PC++] << 8;
-	Opcode |= Memory.Data[Registers.PC++];
-	switch( Opcode >> 12 )
+	uint64_t Result = 0;
+	for( size_t i = 0; i < sizeof(Display.Screen); i++ )
 	{
-	case 0x0:
-	{
-		switch( Opcode & 0xFFF )
-		{
-		case 0xE0: // CLS : Clear screen
-		{
-			std::fill_n(
-				std::begin(Display.Screen),
-				sizeof(Display.Screen),
-				0
-			);
-			break;
-		}
-		case 0xEE: // RET : Return from Subroutine
-		{
-			Registers.PC = Stack[0xF & --Registers.SP];
-			break;
-		}
-		}
-		break;
-	}
-	case 0x1: // JP addr
-	{
-		Registers.PC = Opcode & 0x0FFF;
-		break;
-	}
-	case 0x2: // CALL addr
-	{
-		Stack[0xF & Registers.SP++] = Registers.PC;
-		Registers.PC = Opcode & 0x0FFF;
-		break;
-	}
-	case 0x3: // SE : Skip if Equal immediate
-	{
-		// Keep things branchless
-		Registers.PC += 2 * (Registers.V[(Opcode >> 8) & 0xF] == (Opcode & 0xFF));
-		break;
-	}
-	case 0x4: // SNE : Skip if not Equal immediate
-	{
-		Registers.PC += 2 * (Registers.V[(Opcode >> 8) & 0xF] != (Opcode & 0xFF));
-		break;
-	}
-	case 0x5: // SE : Skip if registers equal
-	{
-		Registers.PC += 2 * (Registers.V[(Opcode >> 8) & 0xF] == Registers.V[(Opcode >> 4) & 0xF]);
-		break;
+		Result ^= Display.Screen[i] ? PixelKey(i) : 0;
 	}
-	case 0x6: // LD : Load immediate
-	{
-		Registers.V[(Opcode >> 8) & 0xF] = Opcode & 0xFF;
-		break;
-	}
-	case 0x7: // ADD: increment immediate
-	{
-		Registers.V[(Opcode >> 8) & 0xF] += Opcode & 0xFF;
-		break;
-	}
-	case 0x8: // Register operators
-	{
-		uint8_t *Dest, *Operand;
-		Dest = &(Registers.V[(Opcode >> 8) & 0xF]);
-		Operand = &(Registers.V[(Opcode >> 4) & 0xF]);
-		switch( Opcode & 0xF )
-		{
-		case 0: // LD : Load register
-		{
-			*Dest = *Operand;
-			break;
-		}
-		case 1: // OR
-		{
-			*Dest = *Dest | *Operand;
-			break;
-		}
-		case 2: // AND
-		{
-			*Dest = *Dest & *Operand;
-			break;
-		}
-		case 3: // XOR
-		{
-			*Dest = *Dest ^ *Operand;
-			break;
-		}
-		case 4: // ADD /CARRY
-		{
-			Registers.V[0xF] = (
-				(static_cast<size_t>(*Dest) + static_cast<size_t>(*Operand)) > 0xFF
-				);
-			*Dest += *Operand;
-			break;
-		}
-		case 5: // SUB /BORROW
-		{
-			Registers.V[0xF] = (static_cast<size_t>(*Dest) > static_cast<size_t>(*Operand));
-			*Dest -= *Operand;
-			break;
-		}
-		case 6: // SHR
-		{
-			Registers.V[0xF] = *Dest & 1;
-			*Dest >>= 1;
-			break;
-		}
-		case 7: // SUBN
-		{
-			Registers.V[0xF] = (static_cast<size_t>(*Operand) > static_cast<size_t>(*Dest));
-			*Operand -= *Dest;
-			break;
-		}
-		case 0xE: // SHL
-		{
-			Registers.V[0xF] = (*Dest & 0x80) >> 7;
-			*Dest <<= 1;
-			break;
-		}
-		}
-		break;
-	}
-	case 0x9: // SNE : Skip if not Equal
-	{
-		Registers.PC += 2 * (Registers.V[(Opcode >> 8) & 0xF] != Registers.V[(Opcode >> 4) & 0xF]);
-		break;
-	}
-	case 0xA: // LD I : Assign Index register
-	{
-		Registers.I = Opcode & 0x0FFF;
-		break;
-	}
-	case 0xB: // JMP : Relative to V0
-	{
-		Registers.PC = Registers.V[0] + (Opcode & 0xFFF);
-		break;
-	}
-	case 0xC: // Random number generator
-	{
-		Registers.V[(Opcode >> 8) & 0xF] = std::uniform_int_distribution<size_t>(0, 0xFF)(RandEng);
-		Registers.V[(Opcode >> 8) & 0xF] &= (Opcode & 0xFF);
-		break;
-	}
-	case 0xD: // Draw 8xN sprite at (x,y) with collision flag
-	{
-		uint8_t SX = Registers.V[(Opcode >> 8) & 0xF];
-		uint8_t SY = Registers.V[(Opcode >> 4) & 0xF];
-		uint8_t Height = Opcode & 0xF;
-		Registers.V[0xF] = 0;
-		for( size_t Y = 0; Y < Height; Y++ )
-		{
-			uint8_t Pixel = Memory.Data[Registers.I + Y];
-			for( size_t X = 0; X < 8; X++ )
-			{
-				if( Pixel & (0x80 >> X) )
-				{
-					if( Display.Screen[X + SX + ((Y + SY) * Width)] )
-					{
-						// Collision
-						Registers.V[0xF] = 1;
-					}
-					Display.Screen[X + SX + ((Y + SY) * Width)] ^= 1;
-				}
-			}
-		}
+	return Result;
+}
 
-		DeltaFrame = true;
-		break;
-	}
-	case 0xE: // Key press conditionals
+uint64_t Chip8::HashRegisters() const
+{
+	uint64_t Result = 0;
+	for( size_t i = 0; i < 16; i++ )
+	{
+		Result ^= RegisterKey(i, Registers.V[i]);
+		Result ^= RegisterKey(0x10 + i, Stack[i]);
+	}
+	Result ^= RegisterKey(0x20, Registers.I);
+	Result ^= RegisterKey(0x21, Registers.PC);
+	Result ^= RegisterKey(0x22, Registers.SP);
+	Result ^= RegisterKey(0x23, Timer.Delay);
+	Result ^= RegisterKey(0x24, Timer.Sound);
+	Result ^= RegisterKey(0x25, Timer.Elapsed);
+	Result ^= RegisterKey(0x26, Random.State);
+	for( size_t i = 0; i < sizeof(Audio.Pattern); i++ )
+	{
+		Result ^= RegisterKey(0x30 + i, Audio.Pattern[i]);
+	}
+	Result ^= RegisterKey(0x40, Audio.Pitch);
+	Result ^= RegisterKey(0x41, Audio.PatternLoaded);
+	return Result;
+}
+
+uint64_t Chip8::GetStateHash() const
+{
+	return Hash.Memory ^ Hash.Screen ^ HashRegisters();
+}
+
+uint64_t Chip8::ComputeStateHash() const
+{
+	return ComputeMemoryHash() ^ ComputeScreenHash() ^ HashRegisters();
+}
+
+const char* Chip8::FindDifference(const Chip8 &Other) const
+{
+	const auto Differs = [](const auto &A, const auto &B)
 	{
-		uint8_t Key = (Opcode & 0xF00) >> 8;
-		switch( Opcode & 0xFF )
-		{
-		case 0x9E: // SKP : Skip if key is pressed
-		{
-			Registers.PC += 2 * ((Keyboard.KeyStates >> Key) & 1);
-			break;
-		}
-		case 0xA1: // SKNP : Skip if key is not pressed
-		{
-			Registers.PC += 2 * (((Keyboard.KeyStates >> Key) & 1) ^ 1);
-			break;
-		}
-		}
-		break;
-	}
-	case 0xF: //
+		return !std::equal(std::begin(A), std::end(A), std::begin(B));
+	};
+	const struct
+	{
+		bool Differs;
+		const char *Name;
+	} Parts[] =
+	{
+		{ Registers.PC != Other.Registers.PC, "PC" },
+		{ Differs(Registers.V, Other.Registers.V), "V" },
+		{ Registers.I != Other.Registers.I, "I" },
+		{ Registers.SP != Other.Registers.SP, "SP" },
+		{ Differs(Stack, Other.Stack), "stack" },
+		{ Differs(Memory.Data, Other.Memory.Data), "memory" },
+		{ Differs(Display.Screen, Other.Display.Screen), "screen" },
+		{ Timer.Delay != Other.Timer.Delay, "delay timer" },
+		{ Timer.Sound != Other.Timer.Sound, "sound timer" },
+		{ Timer.Elapsed != Other.Timer.Elapsed, "timer remainder" },
+		{ Keyboard.KeyStates != Other.Keyboard.KeyStates, "keys" },
+		{ Random.State != Other.Random.State || Seed != Other.Seed, "random state" },
+		{
+			Differs(Audio.Pattern, Other.Audio.Pattern) || Audio.Pitch != Other.Audio.Pitch
+			|| Audio.PatternLoaded != Other.Audio.PatternLoaded,
+			"audio"
+		},
+		{ Cycles != Other.Cycles, "cycles" },
+		{ DeltaFrame != Other.DeltaFrame, "frame flag" },
+		{ Hash.Memory != Other.Hash.Memory || Hash.Screen != Other.Hash.Screen, "hashes" }
+	};
+	for( const auto &Part : Parts )
 	{
-		uint8_t *Arg = &(Registers.V[(Opcode >> 8) & 0xF]);
-		switch( Opcode & 0xFF )
+		if( Part.Differs )
 		{
-		case 0x07: // LD : Load Delay Timer
-		{
-			*Arg = (Timer.Delay / TimerRate);
-			break;
+			return Part.Name;
 		}
-		case 0x0A: // LD : Load upon Keypress
-		{
-			// honk
-			printf("honk");
-			break;
-		}
-		case 0x15: // LD : Set Delay Timer
-		{
-			Timer.Delay = TimerRate * (*Arg);
-			break;
-		}
-		case 0x18: // LD: Set Sound Timer
-		{
-			Timer.Sound = TimerRate * (*Arg);
-			break;
-		}
-		case 0x1E: // ADD : Increment Index
-		{
-			Registers.I += *Arg;
-			break;
-		}
-		case 0x29: // LD : Set Index to Letter Sprite address
-		{
-			Registers.I = *Arg * 5;
-			break;
-		}
-		case 0x33: // LD : Store BDC representation of VX at Index
-		{
-			Memory.Data[Registers.I] = *Arg / 100;
-			Memory.Data[Registers.I + 1] = (*Arg / 10) % 10;
-			Memory.Data[Registers.I + 2] = *Arg % 10;
-			break;
-		}
-		case 0x55: // LD : Stores all General Registers V0 to VX at Index
-		{
-			std::copy_n(
-				std::begin(Registers.V),
-				(Opcode >> 8) & 0xF,
-				&Memory.Data[Registers.I]);
-			break;
-		}
-		case 0x65: // LD : Read all General Registers V0 to VX from Index
-		{
-			std::copy_n(
-				&(Memory.Data[Registers.I]),
-				((Opcode >> 8) & 0xF) + 1,
-				std::begin(Registers.V)
-			);
-			break;
-		}
-		default:
-			break;
-		}
-		break;
 	}
-	}
-
-	// Update timers
-	if( Timer.Delay )
-	{
-		Timer.Delay -= std::min<size_t>(DeltaTime.count(), Timer.Delay);
-	}
-	if( Timer.Sound )
-	{
-		Timer.Sound -= std::min<size_t>(DeltaTime.count(), Timer.Sound);
-		Timer.Sound || putchar(0x7);// bell character
-	}
-	return true;
+	return nullptr;
+}
 }
-}
\ No newline at end of file
@@ -1,8 +1,26 @@
 #include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <atomic>
 #include <memory>
 #include <thread>
+#include <cstdlib>
+#include <csignal>
 
 #include "Wunk8.hpp"
+#include "RomLibrary.hpp"
+#include "TerminalRenderer.hpp"
+#include "Audio.hpp"
+#include "Profiler.hpp"
+#include "PerfCounters.hpp"
+#include "Tracer.hpp"
+#include "Timeline.hpp"
+#include "Metrics.hpp"
+#include "FramePacer.hpp"
+#include "TripleBuffer.hpp"
+#include "Input.hpp"
+#include "SharedFrames.hpp"
+#include "CommandServer.hpp"
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
@@ -11,235 +29,825 @@
 #define SG_DEFINE
 #define SG_W32
 #include "sg.hpp"
+#define WUNK8_WINDOW
+#elif defined(WUNK8_X11)
+#define SG_DEFINE
+#define SG_X11
+#include "sg.hpp"
+#define WUNK8_WINDOW
+#endif
+
+namespace
+{
+// Set by SIGINT/SIGTERM so outputs can be finalized before exiting
+volatile std::sig_atomic_t Quit = 0;
+
+void OnQuitSignal(int)
+{
+	Quit = 1;
+}
+
+#if defined(WUNK8_TRACE)
+// Set by SIGUSR1 to write out the execution trace
+volatile std::sig_atomic_t FlushTrace = 0;
+
+void OnFlushSignal(int)
+{
+	FlushTrace = 1;
+}
 #endif
+}
+
+void PrintUsage(const char *Program)
+{
+	std::cout
+		<< "Usage: " << Program << ' ' << "[options] (Chip8 ROM file)" << std::endl
+		<< "Options:" << std::endl
+		<< "  --library=PATH  Load ROMs from a directory or pack file." << std::endl
+		<< "                  The ROM argument is then a name or content hash." << std::endl
+		<< "  --write-pack=FILE  Write the library out as a pack file and exit" << std::endl
+		<< "  --terminal[=halfblock|braille]  Draw frames into the terminal" << std::endl
+		<< "  --audio=wav:FILE|raw|null  Synthesize sound into a WAV file," << std::endl
+		<< "                  raw 16-bit 44.1khz mono PCM on stdout, or nowhere" << std::endl
+		<< "  --profile=FILE  Write instruction statistics upon exit, as JSON if" << std::endl
+		<< "                  FILE ends in .json and as folded stacks otherwise." << std::endl
+		<< "                  Requires building with WUNK8_PROFILE." << std::endl
+		<< "  --perf-counters Report host hardware counters per emulated" << std::endl
+		<< "                  instruction upon exit(Linux only)" << std::endl
+		<< "  --trace=FILE    Record recent instructions, written to FILE upon" << std::endl
+		<< "                  exit, crash or SIGUSR1. Requires building with" << std::endl
+		<< "                  WUNK8_TRACE. Decode with wunk8-trace." << std::endl
+		<< "  --timeline=FILE Write a Chrome trace-event timeline of frame phases" << std::endl
+		<< "                  upon exit, for chrome://tracing or ui.perfetto.dev" << std::endl
+		<< "  --metrics-port=PORT  Serve Prometheus metrics on 127.0.0.1:PORT" << std::endl
+		<< "  --metrics-file=FILE  Rewrite FILE with Prometheus metrics every second" << std::endl
+		<< "  --ipf=N         Instructions per frame, defaults to the library's" << std::endl
+		<< "                  setting for the ROM or 10" << std::endl
+		<< "  --speed=X       Run X times faster than real time" << std::endl
+		<< "  --turbo         Run as fast as possible" << std::endl
+		<< "  --frameskip=N   Present one of every N + 1 frames" << std::endl
+		<< "  --run-ahead=N   Present the frame N frames ahead of the current" << std::endl
+		<< "                  input, hiding a game's own input lag" << std::endl
+		<< "  --load-state=FILE  Resume from a state written by --save-state" << std::endl
+		<< "  --save-state=FILE  Write the machine state upon exit" << std::endl
+		<< "  --record-input=FILE  Write every applied key event to FILE" << std::endl
+		<< "  --replay=FILE   Replay key events written by --record-input" << std::endl
+		<< "  --bot=SEED      Press random keys, reproducibly for each seed" << std::endl
+		<< "  --input-port=PORT  Accept \"down K\"/\"up K\" lines on 127.0.0.1:PORT" << std::endl
+		<< "  --export-shm=NAME  Publish every frame to the POSIX shared memory" << std::endl
+		<< "                  ring NAME, such as /wunk8" << std::endl
+		<< "  --server        Take binary commands on stdin and answer on stdout" << std::endl
+		<< "                  instead of running a ROM" << std::endl
+		<< "  --server=unix:PATH  Take binary commands on a Unix domain socket" << std::endl;
+}
 
 int main(int argc, char *argv[])
 {
-	if( argc != 2 )
+	const char *RomName = nullptr;
+	std::string LibraryPath;
+	std::string PackPath;
+	bool UseTerminal = false;
+	Wunk8::TerminalRenderer::Mode TerminalMode = Wunk8::TerminalRenderer::Mode::HalfBlock;
+	std::string AudioTarget;
+	std::string ProfilePath;
+	bool UsePerfCounters = false;
+	std::string TracePath;
+	std::string TimelinePath;
+	uint16_t MetricsPort = 0;
+	std::string MetricsPath;
+	uint32_t InstructionsPerFrame = 0;
+	double Speed = 1.0;
+	bool Turbo = false;
+	uint32_t FrameSkip = 0;
+	uint32_t RunAheadFrames = 0;
+	std::string LoadStatePath;
+	std::string SaveStatePath;
+	std::string RecordPath;
+	std::string ReplayPath;
+	bool UseBot = false;
+	uint32_t BotSeed = 0;
+	uint16_t InputPort = 0;
+	std::string ExportName;
+	bool UseServer = false;
+	std::string ServerPath;
+	for( int i = 1; i < argc; i++ )
 	{
-		std::cout << "Usage: " << argv[0] << ' ' << "(Chip8 ROM file)" << std::endl;
+		const std::string Arg(argv[i]);
+		if( Arg.compare(0, 10, "--library=") == 0 )
+		{
+			LibraryPath = Arg.substr(10);
+		}
+		else if( Arg.compare(0, 13, "--write-pack=") == 0 )
+		{
+			PackPath = Arg.substr(13);
+		}
+		else if( Arg == "--terminal" || Arg == "--terminal=halfblock" )
+		{
+			UseTerminal = true;
+			TerminalMode = Wunk8::TerminalRenderer::Mode::HalfBlock;
+		}
+		else if( Arg == "--terminal=braille" )
+		{
+			UseTerminal = true;
+			TerminalMode = Wunk8::TerminalRenderer::Mode::Braille;
+		}
+		else if( Arg.compare(0, 8, "--audio=") == 0 )
+		{
+			AudioTarget = Arg.substr(8);
+		}
+		else if( Arg.compare(0, 10, "--profile=") == 0 )
+		{
+#if defined(WUNK8_PROFILE)
+			ProfilePath = Arg.substr(10);
+#else
+			std::cout << "Built without WUNK8_PROFILE, --profile is unavailable" << std::endl;
+			return EXIT_FAILURE;
+#endif
+		}
+		else if( Arg.compare(0, 8, "--trace=") == 0 )
+		{
+#if defined(WUNK8_TRACE)
+			TracePath = Arg.substr(8);
+#else
+			std::cout << "Built without WUNK8_TRACE, --trace is unavailable" << std::endl;
+			return EXIT_FAILURE;
+#endif
+		}
+		else if( Arg.compare(0, 11, "--timeline=") == 0 )
+		{
+			TimelinePath = Arg.substr(11);
+		}
+		else if( Arg.compare(0, 15, "--metrics-port=") == 0 )
+		{
+			MetricsPort = static_cast<uint16_t>(std::strtoul(Arg.c_str() + 15, nullptr, 10));
+		}
+		else if( Arg.compare(0, 15, "--metrics-file=") == 0 )
+		{
+			MetricsPath = Arg.substr(15);
+		}
+		else if( Arg.compare(0, 6, "--ipf=") == 0 )
+		{
+			InstructionsPerFrame = static_cast<uint32_t>(std::strtoul(Arg.c_str() + 6, nullptr, 10));
+		}
+		else if( Arg.compare(0, 8, "--speed=") == 0 )
+		{
+			Speed = std::strtod(Arg.c_str() + 8, nullptr);
+		}
+		else if( Arg == "--turbo" )
+		{
+			Turbo = true;
+		}
+		else if( Arg.compare(0, 12, "--frameskip=") == 0 )
+		{
+			FrameSkip = static_cast<uint32_t>(std::strtoul(Arg.c_str() + 12, nullptr, 10));
+		}
+		else if( Arg.compare(0, 12, "--run-ahead=") == 0 )
+		{
+			RunAheadFrames = static_cast<uint32_t>(std::strtoul(Arg.c_str() + 12, nullptr, 10));
+		}
+		else if( Arg.compare(0, 13, "--load-state=") == 0 )
+		{
+			LoadStatePath = Arg.substr(13);
+		}
+		else if( Arg.compare(0, 13, "--save-state=") == 0 )
+		{
+			SaveStatePath = Arg.substr(13);
+		}
+		else if( Arg.compare(0, 15, "--record-input=") == 0 )
+		{
+			RecordPath = Arg.substr(15);
+		}
+		else if( Arg.compare(0, 9, "--replay=") == 0 )
+		{
+			ReplayPath = Arg.substr(9);
+		}
+		else if( Arg.compare(0, 6, "--bot=") == 0 )
+		{
+			UseBot = true;
+			BotSeed = static_cast<uint32_t>(std::strtoul(Arg.c_str() + 6, nullptr, 10));
+		}
+		else if( Arg.compare(0, 13, "--input-port=") == 0 )
+		{
+			InputPort = static_cast<uint16_t>(std::strtoul(Arg.c_str() + 13, nullptr, 10));
+		}
+		else if( Arg.compare(0, 13, "--export-shm=") == 0 )
+		{
+			ExportName = Arg.substr(13);
+		}
+		else if( Arg == "--server" )
+		{
+			UseServer = true;
+		}
+		else if( Arg.compare(0, 14, "--server=unix:") == 0 )
+		{
+			UseServer = true;
+			ServerPath = Arg.substr(14);
+		}
+		else if( Arg == "--perf-counters" )
+		{
+			UsePerfCounters = true;
+		}
+		else if( Arg[0] != '-' && RomName == nullptr )
+		{
+			RomName = argv[i];
+		}
+		else
+		{
+			PrintUsage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if( !PackPath.empty() && LibraryPath.empty() )
+	{
+		std::cerr << "--write-pack requires --library" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// The terminal renderer draws to stdout
+	if( UseTerminal && (AudioTarget == "raw" || (UseServer && ServerPath.empty())) )
+	{
+		std::cerr << "--terminal cannot share stdout with --audio=raw or --server" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if( UseServer )
+	{
+		// Headless, the client loads programs itself
+		Wunk8::CommandServer Server(
+			InstructionsPerFrame ? InstructionsPerFrame : Wunk8::RomLibrary::DefaultSpeed
+		);
+		if( ServerPath.empty() )
+		{
+			return Server.Serve(0, 1) ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+		if( !Server.Listen(ServerPath) )
+		{
+			std::cerr << "Unable to serve on " << ServerPath << std::endl;
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+
+	// Audio
+	std::unique_ptr<Wunk8::AudioSink> AudioSink;
+	if( AudioTarget == "raw" )
+	{
+		// Keep stdout clean for sample data
+		std::cout.rdbuf(std::cerr.rdbuf());
+		AudioSink.reset(new Wunk8::RawSink(stdout));
+	}
+	else if( AudioTarget == "null" )
+	{
+		AudioSink.reset(new Wunk8::NullSink());
+	}
+	else if( AudioTarget.compare(0, 4, "wav:") == 0 )
+	{
+		Wunk8::WavSink *Wav = new Wunk8::WavSink(AudioTarget.substr(4), 44100);
+		AudioSink.reset(Wav);
+		if( !Wav->IsOpen() )
+		{
+			std::cout << "Failed to open " << AudioTarget.substr(4) << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	else if( !AudioTarget.empty() )
+	{
+		PrintUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	Wunk8::RomLibrary Library;
+	if( !LibraryPath.empty() )
+	{
+		std::cout << "Opening rom library: " << LibraryPath << "..." << std::endl;
+		if( !Library.Open(LibraryPath) )
+		{
+			std::cout << "Failed!" << std::endl;
+			return EXIT_FAILURE;
+		}
+		std::cout << "Indexed " << Library.GetEntries().size() << " roms" << std::endl;
+		if( !PackPath.empty() )
+		{
+			if( !Library.WritePack(PackPath) )
+			{
+				std::cout
+					<< "Failed to write " << PackPath << ", names are limited to "
+					<< Wunk8::RomLibrary::MaxPackName << " bytes" << std::endl;
+				return EXIT_FAILURE;
+			}
+			return EXIT_SUCCESS;
+		}
+	}
+
+	if( RomName == nullptr )
+	{
+		PrintUsage(argv[0]);
 		return 0;
 	};
 
 	Wunk8::Chip8 Console;
 
-	std::cout << "Loading chip8 rom: " << argv[1] << "..." << std::endl;
+	std::cout << "Loading chip8 rom: " << RomName << "..." << std::endl;
 
-	if( !Console.LoadGame(std::string(argv[1])) )
+	if( !LibraryPath.empty() )
+	{
+		// Look up by name first, then by hexadecimal content hash
+		const Wunk8::RomLibrary::Entry *Rom = Library.Find(std::string(RomName));
+		if( Rom == nullptr )
+		{
+			char *End = nullptr;
+			const uint64_t Hash = std::strtoull(RomName, &End, 16);
+			Rom = *End == '\0' ? Library.Find(Hash) : nullptr;
+		}
+		if( Rom == nullptr || !Wunk8::RomLibrary::Load(Console, *Rom) )
+		{
+			std::cout << "Failed!" << std::endl;
+			return EXIT_FAILURE;
+		}
+		if( InstructionsPerFrame == 0 )
+		{
+			InstructionsPerFrame = Rom->Meta.Speed;
+		}
+	}
+	else if( !Console.LoadGame(std::string(RomName)) )
 	{
 		std::cout << "Failed!" << std::endl;
 		return EXIT_FAILURE;
 	}
+	if( !LoadStatePath.empty() && !Console.LoadStateFile(LoadStatePath) )
+	{
+		std::cout << "Failed to load state from " << LoadStatePath << std::endl;
+		return EXIT_FAILURE;
+	}
 	std::cout << "Done!" << std::endl;
+	if( InstructionsPerFrame == 0 )
+	{
+		InstructionsPerFrame = Wunk8::RomLibrary::DefaultSpeed;
+	}
 
-#if defined(_WIN32)
+#if defined(WUNK8_WINDOW)
 	sg_init("Wunk8", Wunk8::Chip8::Width * 8, Wunk8::Chip8::Height * 8);
 #endif
 
 	std::unique_ptr<uint32_t[]> Screen(new uint32_t[Wunk8::Chip8::Width * Wunk8::Chip8::Height]);
 
-	size_t Frame = 0;
-	while( Console.Tick(std::chrono::milliseconds(16)) )
+	// Kept on the stack since operator new ignores its cache line alignment
+	// before C++17
+	Wunk8::AudioBuffer Samples;
+	std::unique_ptr<Wunk8::Synthesizer> Synth;
+	std::unique_ptr<Wunk8::AudioOutput> AudioOut;
+	if( AudioSink )
 	{
-		if( Console.QueryFrame() )
-		{
-			Frame++;
-			for( size_t i = 0; i < (Wunk8::Chip8::Width * Wunk8::Chip8::Height); i++ )
-			{
-				Screen[i] = Console.GetScreen()[i] ? 0xFFFFFFFF : 0xFF000000;
-			}
-			stbi_write_png((std::to_string(Frame) + ".png").c_str(), 64, 32, 4, Screen.get(), 64 * 4);
-#if defined(_WIN32)
-			sg_paint(
-				Screen.get(),
-				Wunk8::Chip8::Width,
-				Wunk8::Chip8::Height
-			);
+		Synth.reset(new Wunk8::Synthesizer(Samples));
+		AudioOut.reset(
+			new Wunk8::AudioOutput(Samples, *AudioSink, Synth->GetSampleRate())
+		);
+	}
+
+#if defined(WUNK8_PROFILE)
+	std::unique_ptr<Wunk8::Profiler> Prof;
+	if( !ProfilePath.empty() )
+	{
+		Prof.reset(new Wunk8::Profiler());
+		Console.SetProfiler(Prof.get());
+	}
 #endif
-			std::this_thread::sleep_for(std::chrono::milliseconds(16));
+
+#if defined(WUNK8_TRACE)
+	std::unique_ptr<Wunk8::Tracer> Trace;
+	if( !TracePath.empty() )
+	{
+		Trace.reset(new Wunk8::Tracer());
+		Trace->InstallCrashHandler(TracePath.c_str());
+		Console.SetTracer(Trace.get());
+#if defined(SIGUSR1)
+		std::signal(SIGUSR1, OnFlushSignal);
+#endif
+	}
+#endif
+
+	if( !TimelinePath.empty() )
+	{
+		Wunk8::Timeline::Start();
+		Wunk8::Timeline::SetThreadName("present");
+	}
+
+	// Metrics are updated once per frame and read from their own threads
+	Wunk8::Metrics::Registry Metrics;
+	Wunk8::Metrics::Counter &InstructionsTotal = Metrics.AddCounter(
+		"wunk8_instructions_total", "Instructions emulated"
+	);
+	Wunk8::Metrics::Gauge &InstructionsPerSecond = Metrics.AddGauge(
+		"wunk8_instructions_per_second", "Instructions emulated per wall-clock second"
+	);
+	Wunk8::Metrics::Counter &FramesTotal = Metrics.AddCounter(
+		"wunk8_frames_total", "Frames emulated"
+	);
+	Wunk8::Metrics::Gauge &FramesPerSecond = Metrics.AddGauge(
+		"wunk8_frames_per_second", "Frames emulated per wall-clock second"
+	);
+	Wunk8::Metrics::Counter &FramesPresented = Metrics.AddCounter(
+		"wunk8_frames_presented_total", "Frames picked up by the presentation thread"
+	);
+	Wunk8::Metrics::Counter &FramesDropped = Metrics.AddCounter(
+		"wunk8_frames_dropped_total", "Frame intervals given up on after falling behind"
+	);
+	Wunk8::Metrics::Histogram &FrameTime = Metrics.AddHistogram(
+		"wunk8_frame_time_microseconds", "Wall-clock time between frames"
+	);
+	Wunk8::Metrics::Histogram &FrameJitter = Metrics.AddHistogram(
+		"wunk8_frame_jitter_microseconds", "Distance of each frame time from its target"
+	);
+	Wunk8::Metrics::Histogram &InputLatency = Metrics.AddHistogram(
+		"wunk8_input_latency_microseconds", "Time from receiving a key event to presenting the first frame emulated with it"
+	);
+	Wunk8::Metrics::Counter &FramesLate = Metrics.AddCounter(
+		"wunk8_frames_late_total", "Frames that finished emulating after their deadline"
+	);
+	Wunk8::Metrics::Counter &FramesSkipped = Metrics.AddCounter(
+		"wunk8_frames_skipped_total", "Frames emulated but not presented"
+	);
+	Wunk8::Metrics::Histogram &PacingError = Metrics.AddHistogram(
+		"wunk8_pacing_error_microseconds", "Distance of each frame's wake-up from its deadline"
+	);
+	Wunk8::Metrics::Server MetricsServer(Metrics);
+	if( MetricsPort != 0 && !MetricsServer.Start(MetricsPort) )
+	{
+		std::cerr << "Unable to serve metrics on port " << MetricsPort << std::endl;
+	}
+	Wunk8::Metrics::FileWriter MetricsFile(Metrics, MetricsPath);
+	if( !MetricsPath.empty() )
+	{
+		MetricsFile.Start(std::chrono::seconds(1));
+	}
+
+	const std::chrono::microseconds FramePeriod = Wunk8::DefaultFramePeriod;
+	Wunk8::FramePacer Pacer(FramePeriod);
+	Pacer.SetSpeed(Speed);
+	Pacer.SetTurbo(Turbo);
+	Pacer.SetFrameSkip(FrameSkip);
+	const uint64_t TargetFrameTime = static_cast<uint64_t>(FramePeriod.count() / Pacer.GetSpeed());
+
+	using Clock = std::chrono::steady_clock;
+
+	// Completed frames, handed from the emulation thread to this one
+	struct FrameBuffer
+	{
+		uint8_t Screen[Wunk8::Chip8::Width * Wunk8::Chip8::Height];
+		// When the key state this frame was emulated with was read
+		Clock::time_point InputSampled;
+	};
+	Wunk8::TripleBuffer<FrameBuffer> Frames;
+	// Key events from every source, applied by the emulation thread at the
+	// instruction count each one is stamped with or arrived during
+	Wunk8::InputMux Input;
+	Input.SetFrameLength(Pacer.GetScaledPeriod(), InstructionsPerFrame);
+	Wunk8::LiveInput WindowInput;
+	Input.AddSource(WindowInput);
+	Wunk8::ReplayInput Replay;
+	if( !ReplayPath.empty() )
+	{
+		if( !Replay.Open(ReplayPath) )
+		{
+			std::cout << "Failed to open " << ReplayPath << std::endl;
+			return EXIT_FAILURE;
 		}
-#if defined(_WIN32)
-		sg_event Event;
-		if( sg_poll(&Event) )
+		Input.AddSource(Replay);
+	}
+	Wunk8::BotInput Bot;
+	if( UseBot )
+	{
+		Bot.Start(BotSeed);
+		Input.AddSource(Bot);
+	}
+	Wunk8::SocketInput SocketSource;
+	if( InputPort != 0 )
+	{
+		if( !SocketSource.Start(InputPort) )
 		{
-			if( Event.type == SG_ev_keydown )
+			std::cerr << "Unable to accept input on port " << InputPort << std::endl;
+		}
+		Input.AddSource(SocketSource);
+	}
+	if( !RecordPath.empty() && !Input.Record(RecordPath) )
+	{
+		std::cout << "Failed to open " << RecordPath << std::endl;
+		return EXIT_FAILURE;
+	}
+	Wunk8::SharedFrames::Writer Export;
+	if( !ExportName.empty() && !Export.Open(ExportName) )
+	{
+		std::cerr << "Unable to create shared memory " << ExportName << std::endl;
+		return EXIT_FAILURE;
+	}
+	// Takes over the terminal until it is destroyed, so only once nothing
+	// else can fail and print
+	std::unique_ptr<Wunk8::TerminalRenderer> Terminal;
+	if( UseTerminal )
+	{
+		Terminal.reset(new Wunk8::TerminalRenderer(TerminalMode));
+	}
+	std::atomic<bool> Running(true);
+
+	// Scratch console for running ahead of the real one
+	Wunk8::Chip8 Ahead;
+
+	// Counters only measure the emulation thread, which opens them
+	Wunk8::PerfCounters Perf;
+
+	std::signal(SIGINT, OnQuitSignal);
+	std::signal(SIGTERM, OnQuitSignal);
+
+	// The emulation thread owns the console and never waits on presentation
+	std::thread Emulation(
+		[&]()
+		{
+			if( Wunk8::Timeline::IsEnabled() )
 			{
-				switch( Event.key )
-				{
-				case '1':
-				{
-					Console.KeyDown(1);
-					break;
-				}
-				case '2':
-				{
-					Console.KeyDown(1 << 1);
-					break;
-				}
-				case '3':
-				{
-					Console.KeyDown(1 << 2);
-					break;
-				}
-				case '4':
-				{
-					Console.KeyDown(1 << 3);
-					break;
-				}
-				case 'q':
-				{
-					Console.KeyDown(1 << 4);
-					break;
-				}
-				case 'w':
-				{
-					Console.KeyDown(1 << 5);
-					break;
-				}
-				case 'e':
-				{
-					Console.KeyDown(1 << 6);
-					break;
-				}
-				case 'r':
-				{
-					Console.KeyDown(1 << 7);
-					break;
-				}
-				case 'a':
-				{
-					Console.KeyDown(1 << 8);
-					break;
-				}
-				case 's':
-				{
-					Console.KeyDown(1 << 9);
-					break;
-				}
-				case 'd':
-				{
-					Console.KeyDown(1 << 10);
-					break;
-				}
-				case 'f':
-				{
-					Console.KeyDown(1 << 11);
-					break;
-				}
-				case 'z':
-				{
-					Console.KeyDown(1 << 12);
-					break;
-				}
-				case 'x':
-				{
-					Console.KeyDown(1 << 13);
-					break;
-				}
-				case 'c':
-				{
-					Console.KeyDown(1 << 14);
-					break;
-				}
-				case 'v':
-				{
-					Console.KeyDown(1 << 15);
-					break;
-				}
-				}
+				Wunk8::Timeline::SetThreadName("emulation");
 			}
-			if( Event.type == SG_ev_keyup )
+			if( UsePerfCounters && !Perf.Open() )
 			{
-				switch( Event.key )
-				{
-				case '1':
-				{
-					Console.KeyUp(1);
-					break;
-				}
-				case '2':
-				{
-					Console.KeyUp(1 << 1);
-					break;
-				}
-				case '3':
-				{
-					Console.KeyUp(1 << 2);
-					break;
-				}
-				case '4':
-				{
-					Console.KeyUp(1 << 3);
-					break;
-				}
-				case 'q':
-				{
-					Console.KeyUp(1 << 4);
-					break;
-				}
-				case 'w':
-				{
-					Console.KeyUp(1 << 5);
-					break;
-				}
-				case 'e':
-				{
-					Console.KeyUp(1 << 6);
-					break;
-				}
-				case 'r':
-				{
-					Console.KeyUp(1 << 7);
-					break;
-				}
-				case 'a':
-				{
-					Console.KeyUp(1 << 8);
-					break;
-				}
-				case 's':
-				{
-					Console.KeyUp(1 << 9);
-					break;
-				}
-				case 'd':
-				{
-					Console.KeyUp(1 << 10);
-					break;
+				std::cerr << "Unable to open hardware performance counters" << std::endl;
+			}
+			uint64_t BatchInstructions = 0;
+			Perf.Begin();
+			uint64_t BatchStart = Wunk8::Timeline::IsEnabled() ? Wunk8::Timeline::Now() : 0;
+
+			Pacer.Reset();
+			Clock::time_point LastFrame = Clock::now();
+			Clock::time_point RateStart = LastFrame;
+			uint64_t RateInstructions = 0;
+			uint64_t RateFrames = 0;
+			Wunk8::FramePacer::Stats LastPacing = Pacer.GetStats();
+
+			while( !Quit && Running.load(std::memory_order_relaxed) )
+			{
+				const Clock::time_point InputSampled = Clock::now();
+				Input.BeginFrame(Console.GetCycles(), Pacer.GetFrameStart());
+				uint32_t Executed = 0;
+				while( Executed < InstructionsPerFrame && Running.load(std::memory_order_relaxed) )
+				{
+					// Run uninterrupted up to the next pending key event
+					const uint64_t NextEvent = Input.Apply(Console);
+					const uint32_t Batch = static_cast<uint32_t>(std::min<uint64_t>(
+						InstructionsPerFrame - Executed, NextEvent - Console.GetCycles()
+					));
+					for( uint32_t i = Executed; i < Executed + Batch; i++ )
+					{
+						const std::chrono::microseconds TickTime = Wunk8::GetTickTime(
+							i, InstructionsPerFrame, FramePeriod
+						);
+						if( !Console.Tick(TickTime) )
+						{
+							Running.store(false);
+							break;
+						}
+						BatchInstructions++;
+						if( Synth )
+						{
+							Synth->Advance(Console, TickTime);
+						}
+					}
+					Executed += Batch;
+				}
+#if defined(WUNK8_TRACE)
+				if( FlushTrace && Trace )
+				{
+					FlushTrace = 0;
+					Trace->Flush(TracePath.c_str());
 				}
-				case 'f':
+#endif
+				Perf.End(BatchInstructions);
+				InstructionsTotal.Add(BatchInstructions);
+				RateInstructions += BatchInstructions;
+				BatchInstructions = 0;
+				if( Wunk8::Timeline::IsEnabled() )
 				{
-					Console.KeyUp(1 << 11);
-					break;
+					Wunk8::Timeline::Record("emulate", BatchStart, Wunk8::Timeline::Now());
 				}
-				case 'z':
-				{
-					Console.KeyUp(1 << 12);
-					break;
+
+				// Every emulated frame, presented or not
+				Export.Publish(Console);
+
+				if( Pacer.ShouldPresent() )
+				{
+					const uint8_t *Shown = nullptr;
+					if( RunAheadFrames != 0 )
+					{
+						// Present where the current input leads a few frames from
+						// now, leaving the real console untouched
+						WUNK8_TIMELINE_SCOPE("run ahead");
+						Console.QueryFrame();
+						Ahead.LoadState(Console);
+						for( uint32_t i = 0; i < RunAheadFrames * InstructionsPerFrame; i++ )
+						{
+							const std::chrono::microseconds TickTime = Wunk8::GetTickTime(
+								i % InstructionsPerFrame, InstructionsPerFrame, FramePeriod
+							);
+							if( !Ahead.Tick(TickTime) )
+							{
+								break;
+							}
+						}
+						Shown = Ahead.GetScreen();
+					}
+					else if( Console.QueryFrame() )
+					{
+						// Frames that were not drawn to are not presented again
+						Shown = Console.GetScreen();
+					}
+					if( Shown != nullptr )
+					{
+						FrameBuffer &Back = Frames.GetBackBuffer();
+						std::copy_n(Shown, sizeof(Back.Screen), Back.Screen);
+						Back.InputSampled = InputSampled;
+						Frames.Publish();
+					}
 				}
-				case 'x':
+
 				{
-					Console.KeyUp(1 << 13);
-					break;
-				}
-				case 'c':
+					WUNK8_TIMELINE_SCOPE("pace");
+					Pacer.Wait();
+				}
+				{
+					const Clock::time_point Now = Clock::now();
+					const uint64_t Elapsed = static_cast<uint64_t>(
+						std::chrono::duration_cast<std::chrono::microseconds>(Now - LastFrame).count()
+					);
+					FrameTime.Record(Elapsed);
+					FrameJitter.Record(
+						Elapsed > TargetFrameTime ? Elapsed - TargetFrameTime : TargetFrameTime - Elapsed
+					);
+					const Wunk8::FramePacer::Stats &Pacing = Pacer.GetStats();
+					FramesDropped.Add(Pacing.Dropped - LastPacing.Dropped);
+					FramesLate.Add(Pacing.Late - LastPacing.Late);
+					FramesSkipped.Add(Pacing.Skipped - LastPacing.Skipped);
+					if( !Pacer.IsTurbo() )
+					{
+						PacingError.Record(static_cast<uint64_t>(
+							std::chrono::duration_cast<std::chrono::microseconds>(
+								Pacing.LastError < Pacing.LastError.zero() ? -Pacing.LastError : Pacing.LastError
+							).count()
+						));
+					}
+					LastPacing = Pacing;
+					FramesTotal.Add();
+					RateFrames++;
+					const std::chrono::duration<double> RateWindow = Now - RateStart;
+					if( RateWindow.count() >= 1.0 )
+					{
+						InstructionsPerSecond.Set(RateInstructions / RateWindow.count());
+						FramesPerSecond.Set(RateFrames / RateWindow.count());
+						RateInstructions = 0;
+						RateFrames = 0;
+						RateStart = Now;
+					}
+					LastFrame = Now;
+				}
+				Perf.Begin();
+				BatchStart = Wunk8::Timeline::IsEnabled() ? Wunk8::Timeline::Now() : 0;
+			}
+			Perf.End(BatchInstructions);
+			InstructionsTotal.Add(BatchInstructions);
+			Running.store(false);
+		}
+	);
+
+	// Presentation runs on this thread, which also owns the window
+	// Oldest key event not yet reflected in a presented frame
+	bool InputPending = false;
+	Clock::time_point InputTime;
+	size_t Frame = 0;
+	while( Running.load(std::memory_order_relaxed) )
+	{
+		if( Frames.Update() )
+		{
+			const FrameBuffer &Front = Frames.GetFrontBuffer();
+			Frame++;
+			{
+				WUNK8_TIMELINE_SCOPE("screen convert");
+				for( size_t i = 0; i < (Wunk8::Chip8::Width * Wunk8::Chip8::Height); i++ )
 				{
-					Console.KeyUp(1 << 14);
-					break;
+					Screen[i] = Front.Screen[i] ? 0xFFFFFFFF : 0xFF000000;
 				}
-				case 'v':
+			}
+			if( Terminal )
+			{
+				WUNK8_TIMELINE_SCOPE("terminal draw");
+				Terminal->Draw(Front.Screen);
+			}
+			{
+				WUNK8_TIMELINE_SCOPE("png encode");
+				stbi_write_png((std::to_string(Frame) + ".png").c_str(), 64, 32, 4, Screen.get(), 64 * 4);
+			}
+#if defined(WUNK8_WINDOW)
+			{
+				WUNK8_TIMELINE_SCOPE("window paint");
+				sg_paint(
+					Screen.get(),
+					Wunk8::Chip8::Width,
+					Wunk8::Chip8::Height
+				);
+			}
+#endif
+			FramesPresented.Add();
+			if( InputPending && Front.InputSampled >= InputTime )
+			{
+				InputLatency.Record(static_cast<uint64_t>(
+					std::chrono::duration_cast<std::chrono::microseconds>(
+						Clock::now() - InputTime
+					).count()
+				));
+				InputPending = false;
+			}
+		}
+#if defined(WUNK8_WINDOW)
+		sg_event Event;
+		// Polling happens every millisecond, so only polls that returned an
+		// event are put on the timeline
+		const uint64_t PollStart = Wunk8::Timeline::IsEnabled() ? Wunk8::Timeline::Now() : 0;
+		bool Polled = false;
+		while( sg_poll(&Event) )
+		{
+			Polled = true;
+			if( Event.type == SG_ev_quit )
+			{
+				Running.store(false);
+				break;
+			}
+			if( Event.type == SG_ev_keydown || Event.type == SG_ev_keyup )
+			{
+				const int Key = Wunk8::KeypadFromChar(Event.key);
+				if( Key >= 0 )
 				{
-					Console.KeyUp(1 << 15);
-					break;
-				}
+					WindowInput.Press(static_cast<uint8_t>(Key), Event.type == SG_ev_keydown);
+					if( !InputPending )
+					{
+						InputPending = true;
+						InputTime = Clock::now();
+					}
 				}
 			}
 		}
+		if( Polled && Wunk8::Timeline::IsEnabled() )
+		{
+			Wunk8::Timeline::Record("input poll", PollStart, Wunk8::Timeline::Now());
+		}
 #endif
+		// Frames arrive at most once per period, so a short nap adds little
+		// latency
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	Emulation.join();
+	if( !SaveStatePath.empty() && !Console.SaveStateFile(SaveStatePath) )
+	{
+		std::cerr << "Failed to save state to " << SaveStatePath << std::endl;
 	}
 
+	MetricsServer.Stop();
+	MetricsFile.Stop();
 	Screen.reset();
-#if defined(_WIN32)
+#if defined(WUNK8_TRACE)
+	if( Trace )
+	{
+		Trace->Flush(TracePath.c_str());
+	}
+#endif
+#if defined(WUNK8_PROFILE)
+	if( Prof )
+	{
+		std::ofstream ProfileFile(ProfilePath);
+		const bool Json = ProfilePath.size() >= 5
+			&& ProfilePath.compare(ProfilePath.size() - 5, 5, ".json") == 0;
+		Json ? Prof->WriteJson(ProfileFile) : Prof->WriteFolded(ProfileFile);
+	}
+#endif
+	if( !TimelinePath.empty() )
+	{
+		Wunk8::Timeline::Stop();
+		Wunk8::Timeline::Write(TimelinePath);
+	}
+	if( Perf.IsOpen() )
+	{
+#if defined(WUNK8_PROFILE)
+		Perf.WriteReport(std::cerr, Prof.get());
+#else
+		Perf.WriteReport(std::cerr);
+#endif
+	}
+	if( Synth )
+	{
+		const Wunk8::AudioOutput::Stats OutputStats = AudioOut->GetStats();
+		AudioOut.reset();
+		const Wunk8::Synthesizer::Stats SynthStats = Synth->GetStats();
+		std::cerr
+			<< "Audio: " << SynthStats.Samples << " samples, "
+			<< SynthStats.Overruns << " overrun, "
+			<< OutputStats.Underruns << " underrun" << std::endl;
+	}
+#if defined(WUNK8_WINDOW)
 	sg_exit();
 #endif
 
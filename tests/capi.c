@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wunk8.h"
+
+/*
+ * Drives the shared library through its C interface alone, as a C program
+ * would: single consoles, clones, saved states and vectorized environments.
+ */
+
+static int Failed = 0;
+
+static void Check(int Condition, const char *What)
+{
+	if( !Condition )
+	{
+		printf("FAIL %s\n", What);
+		Failed = 1;
+	}
+}
+
+/* Waits for key 5 and then draws the digit 5 in the top left corner */
+static const uint8_t Program[] = {
+	0x60, 0x05,
+	0xE0, 0x9E,
+	0x12, 0x02,
+	0xF0, 0x29,
+	0xD1, 0x15,
+	0x12, 0x0A
+};
+
+static size_t CountLit(const uint8_t *Bytes, size_t Size)
+{
+	size_t Lit = 0;
+	size_t i;
+	for( i = 0; i < Size; i++ )
+	{
+		Lit += Bytes[i] != 0;
+	}
+	return Lit;
+}
+
+static void TestConsole(void)
+{
+	wunk8_chip8 *Console = wunk8_create(1);
+	wunk8_chip8 *Copy;
+	uint8_t *State;
+	uint64_t Saved;
+	Check(Console != NULL, "create");
+	if( Console == NULL )
+	{
+		return;
+	}
+	Check(wunk8_load(Console, NULL, 0) == -1, "load without a program");
+	Check(wunk8_load(Console, Program, sizeof(Program)) == 0, "load");
+	Check(wunk8_run(Console, 10, 1600) == 10, "run");
+	Check(wunk8_cycles(Console) == 10, "cycles");
+	Check(CountLit(wunk8_screen(Console), WUNK8_SCREEN_WIDTH * WUNK8_SCREEN_HEIGHT) == 0, "drew before the key");
+	Check(memcmp(wunk8_memory(Console) + 0x200, Program, sizeof(Program)) == 0, "program in memory");
+
+	/* A clone carries on exactly as the original does */
+	Copy = wunk8_clone(Console);
+	Check(Copy != NULL, "clone");
+	if( Copy != NULL )
+	{
+		Check(wunk8_state_hash(Copy) == wunk8_state_hash(Console), "clone hash");
+		wunk8_key_down(Console, 5);
+		wunk8_key_down(Copy, 5);
+		wunk8_run(Console, 10, 1600);
+		wunk8_run(Copy, 10, 1600);
+		Check(wunk8_state_hash(Copy) == wunk8_state_hash(Console), "clone hash after running");
+		Check(wunk8_screen_hash(Copy) == wunk8_screen_hash(Console), "clone screen after running");
+		wunk8_destroy(Copy);
+	}
+	Check(wunk8_get_keys(Console) == 1 << 5, "keys");
+	Check(CountLit(wunk8_screen(Console), WUNK8_SCREEN_WIDTH * WUNK8_SCREEN_HEIGHT) != 0, "drew after the key");
+	Check(wunk8_frame_drawn(Console) == 1, "frame drawn");
+	Check(wunk8_frame_drawn(Console) == 0, "frame drawn twice");
+
+	/* Saved states come back exactly */
+	State = (uint8_t*)malloc(wunk8_state_size());
+	Check(State != NULL, "state buffer");
+	if( State != NULL )
+	{
+		Check(wunk8_save_state(Console, State, wunk8_state_size() - 1) == -1, "save into a short buffer");
+		Check(wunk8_save_state(Console, State, wunk8_state_size()) == 0, "save state");
+		Saved = wunk8_state_hash(Console);
+		wunk8_reset(Console);
+		Check(wunk8_cycles(Console) == 0, "reset");
+		Check(wunk8_state_hash(Console) != Saved, "hash after reset");
+		Check(wunk8_load_state(Console, State, wunk8_state_size() + 1) == -1, "load a wrong size");
+		Check(wunk8_load_state(Console, State, wunk8_state_size()) == 0, "load state");
+		Check(wunk8_state_hash(Console) == Saved, "hash after loading state");
+		Check(wunk8_cycles(Console) == 20, "cycles after loading state");
+		free(State);
+	}
+	wunk8_destroy(Console);
+}
+
+static void TestVecEnv(void)
+{
+	const size_t Count = 3;
+	const size_t ScreenSize = WUNK8_SCREEN_WIDTH * WUNK8_SCREEN_HEIGHT / 8;
+	const uint16_t Keys[3] = { 1 << 5, 0, 1 << 5 };
+	const uint32_t Frames[3] = { 2, 2, 1 };
+	const uint16_t Addresses[2] = { 0x200, 0x201 };
+	uint8_t Observations[3 * (WUNK8_SCREEN_WIDTH * WUNK8_SCREEN_HEIGHT / 8)];
+	wunk8_vec_env *Env = wunk8_vec_env_create(Count, 10, 1);
+	Check(Env != NULL, "vec_env create");
+	if( Env == NULL )
+	{
+		return;
+	}
+	Check(wunk8_vec_env_load(Env, Program, sizeof(Program)) == 0, "vec_env load");
+	wunk8_vec_env_observe_screen(Env);
+	Check(wunk8_vec_env_observation_size(Env) == ScreenSize, "screen observation size");
+
+	memset(Observations, 0xFF, sizeof(Observations));
+	wunk8_vec_env_step(Env, Keys, Frames, Observations);
+	Check(CountLit(Observations, ScreenSize) != 0, "console 0 drew");
+	Check(CountLit(Observations + ScreenSize, ScreenSize) == 0, "console 1 drew without its key");
+	Check(memcmp(Observations, Observations + ScreenSize * 2, ScreenSize) == 0, "console 2 drew");
+	Check(wunk8_vec_env_state_hash(Env, 0) != wunk8_vec_env_state_hash(Env, 1), "state hashes");
+	Check(wunk8_vec_env_state_hash(Env, Count) == 0, "state hash past the end");
+
+	Check(wunk8_vec_env_reset(Env, 0) == 0, "vec_env reset");
+	Check(wunk8_vec_env_reset(Env, Count) == -1, "vec_env reset past the end");
+	wunk8_vec_env_observe(Env, Observations);
+	Check(CountLit(Observations, ScreenSize) == 0, "screen after reset");
+
+	Check(wunk8_vec_env_observe_memory(Env, Addresses, 2) == 0, "observe memory");
+	Check(wunk8_vec_env_observation_size(Env) == 2, "memory observation size");
+	wunk8_vec_env_step(Env, NULL, NULL, Observations);
+	Check(Observations[0] == Program[0] && Observations[1] == Program[1], "memory observation");
+	Check(Observations[4] == Program[0] && Observations[5] == Program[1], "last memory observation");
+	wunk8_vec_env_destroy(Env);
+}
+
+int main(void)
+{
+	Check(wunk8_version() == 1, "version");
+	TestConsole();
+	TestVecEnv();
+	if( Failed )
+	{
+		return EXIT_FAILURE;
+	}
+	printf("PASS\n");
+	return EXIT_SUCCESS;
+}
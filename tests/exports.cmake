@@ -0,0 +1,24 @@
+# Fails unless every symbol the shared library LIBRARY exports is part of
+# the C interface. Run with cmake -DNM=... -DLIBRARY=... -P exports.cmake
+execute_process(
+	COMMAND ${NM} -D --defined-only ${LIBRARY}
+	OUTPUT_VARIABLE SYMBOLS
+	RESULT_VARIABLE RESULT
+)
+if( NOT RESULT EQUAL 0 )
+	message( FATAL_ERROR "Unable to list the symbols of ${LIBRARY}" )
+endif()
+string( REGEX MATCHALL "[^\n]+" LINES "${SYMBOLS}" )
+set( FOUND 0 )
+foreach( LINE ${LINES} )
+	string( REGEX REPLACE ".* " "" NAME "${LINE}" )
+	if( NAME MATCHES "^wunk8_" )
+		math( EXPR FOUND "${FOUND} + 1" )
+	else()
+		message( SEND_ERROR "Exported outside the C interface: ${NAME}" )
+	endif()
+endforeach()
+if( FOUND EQUAL 0 )
+	message( FATAL_ERROR "No C interface exported from ${LIBRARY}" )
+endif()
+message( STATUS "${FOUND} symbols exported" )
@@ -0,0 +1,445 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+
+#include "Wunk8.hpp"
+#include "Replay.hpp"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+// Runs every ROM of a corpus headlessly with scripted input and compares
+// screen and state hashes at fixed instruction counts against golden values.
+// Each interval between checkpoints is split into Subdivisions steps that
+// are compared as well, and a drifting incremental hash is narrowed down to
+// the instruction that caused it. The first mismatch of each case dumps the
+// screen as a PNG and the machine state, for loading with wunk8 --load-state.
+namespace
+{
+void PrintUsage(const char *Program)
+{
+	std::cout
+		<< "Usage: " << Program << " [options] (corpus file) (golden file)" << std::endl
+		<< "Options:" << std::endl
+		<< "  --update        Rewrite the golden file from this run" << std::endl
+		<< "  --jobs=N        Cases run in parallel(all cores)" << std::endl
+		<< "  --dump=DIR      Where mismatches are dumped(.)" << std::endl
+		<< "Corpus lines are \"name rom input ipf checkpoints\", where rom is a" << std::endl
+		<< "path relative to the corpus file or synthetic:NAME, input is a" << std::endl
+		<< "wunk8 --record-input file or - and checkpoints is a comma separated" << std::endl
+		<< "list of instruction counts." << std::endl;
+}
+
+// Programs written out here rather than shipped as binaries
+std::vector<uint16_t> GetSynthetic(const std::string &Name)
+{
+	if( Name == "opcodes" )
+	{
+		// Arithmetic with flags, BCD, stores and loads, random numbers,
+		// font sprites drawn wrapping around both edges, timers and calls
+		return {
+			/* 200 */ 0xA300, 0xC0FF, 0xC1FF, 0x8014, 0x8125, 0x8206, 0x830E, 0x8411,
+			/* 210 */ 0x8512, 0x8613, 0x8717, 0xF033, 0xFF55, 0xA300, 0xF265, 0x2280,
+			/* 220 */ 0x7E01, 0x3E00, 0x1200, 0x00E0, 0x1200, 0x0000, 0x0000, 0x0000,
+			/* 230 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+			/* 240 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+			/* 250 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+			/* 260 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+			/* 270 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+			/* 280 */ 0xF829, 0xD9A5, 0x7803, 0x793B, 0x7A1D, 0xF815, 0xFB07, 0x4B00,
+			/* 290 */ 0x7C01, 0x00EE
+		};
+	}
+	if( Name == "keys" )
+	{
+		// Waits for a key and draws its digit, sliding it right for as long
+		// as the key is held
+		return {
+			/* 200 */ 0xF00A, 0x00E0, 0xF029, 0x6100, 0x6200, 0xD125, 0xE0A1, 0x1212,
+			/* 210 */ 0x1200, 0xD125, 0x7104, 0xD125, 0x120C
+		};
+	}
+	return {};
+}
+
+// Start-up code of the kind every instance repeats: clears the screen, draws
+// a digit across the corner, stores a random number as BCD and loads it back,
+// sets both timers, counts to 40 through a subroutine and waits for a key
+constexpr uint8_t BootProgram[] =
+{
+	/* 200 */ 0x00, 0xE0, 0x60, 0x07, 0xF0, 0x29, 0x61, 0x3E, 0x62, 0x1E, 0xD1, 0x25,
+	/* 20C */ 0xC3, 0xFF, 0xA3, 0x00, 0xF3, 0x33, 0xF2, 0x65, 0x64, 0x3C, 0xF4, 0x15,
+	/* 218 */ 0xF4, 0x18, 0x75, 0x01, 0x22, 0x24, 0x35, 0x28, 0x12, 0x1A, 0xF6, 0x0A,
+	/* 224 */ 0xFA, 0x07, 0x00, 0xEE
+};
+constexpr uint64_t BootInstructions = 1000;
+
+// The same boot evaluated by the compiler and at run time must agree
+std::string CheckBootImage()
+{
+	static constexpr Wunk8::Chip8 Baked = Wunk8::BootImage(
+		BootProgram, sizeof(BootProgram), BootInstructions
+	);
+	Wunk8::Chip8 Console;
+	Console.LoadGame(BootProgram, sizeof(BootProgram));
+	while( Console.GetCycles() < BootInstructions )
+	{
+		Console.Tick(Wunk8::GetTickTime(static_cast<uint32_t>(Console.GetCycles() % 10), 10));
+	}
+	const char *Part = Console.FindDifference(Baked);
+	return Part == nullptr ? "" : std::string(Part) + " differs from the compile time boot";
+}
+
+struct Case
+{
+	std::string Name;
+	std::string Rom;
+	std::string Input;
+	uint32_t InstructionsPerFrame;
+	std::vector<uint64_t> Checkpoints;
+};
+
+struct Checkpoint
+{
+	uint64_t ScreenHash;
+	uint64_t StateHash;
+};
+
+// Golden values, keyed by case name and instruction count
+using Golden = std::map<std::pair<std::string, uint64_t>, Checkpoint>;
+
+// Golden values are also kept at this many evenly spaced steps between
+// consecutive checkpoints, so mismatches are caught close to where they begin
+constexpr uint64_t Subdivisions = 16;
+
+struct Outcome
+{
+	// Instruction count and hashes of every step compared
+	std::vector<std::pair<uint64_t, Checkpoint>> Results;
+	std::string Error;
+	std::string Failure;
+};
+
+bool DumpState(const Wunk8::Chip8 &Console, const std::string &Prefix)
+{
+	uint32_t Pixels[Wunk8::Chip8::Width * Wunk8::Chip8::Height];
+	for( size_t i = 0; i < Wunk8::Chip8::Width * Wunk8::Chip8::Height; i++ )
+	{
+		Pixels[i] = Console.GetScreen()[i] ? 0xFFFFFFFF : 0xFF000000;
+	}
+	const bool Written = stbi_write_png(
+		(Prefix + ".png").c_str(), Wunk8::Chip8::Width, Wunk8::Chip8::Height, 4,
+		Pixels, Wunk8::Chip8::Width * 4
+	) != 0;
+	return Console.SaveStateFile(Prefix + ".state") && Written;
+}
+
+Outcome Run(
+	const Case &Test, const std::string &BaseDir, const Golden &Expected, bool Update,
+	const std::string &DumpDir
+)
+{
+	Outcome Result;
+	Wunk8::Chip8 Console;
+	if( Test.Rom.compare(0, 10, "synthetic:") == 0 )
+	{
+		const std::vector<uint16_t> Code = GetSynthetic(Test.Rom.substr(10));
+		if( Code.empty() )
+		{
+			Result.Error = "unknown synthetic program " + Test.Rom;
+			return Result;
+		}
+		std::vector<uint8_t> Bytes;
+		for( const uint16_t Opcode : Code )
+		{
+			Bytes.push_back(static_cast<uint8_t>(Opcode >> 8));
+			Bytes.push_back(static_cast<uint8_t>(Opcode));
+		}
+		Console.LoadGame(Bytes.data(), Bytes.size());
+	}
+	else if( !Console.LoadGame(BaseDir + Test.Rom) )
+	{
+		Result.Error = "unable to open " + Test.Rom;
+		return Result;
+	}
+	std::vector<Wunk8::ReplayEvent> Events;
+	if( Test.Input != "-" && !Wunk8::ReadReplay(BaseDir + Test.Input, Events) )
+	{
+		Result.Error = "unable to open " + Test.Input;
+		return Result;
+	}
+
+	size_t NextEvent = 0;
+	// Runs up to instruction count Target. CheckEach also stops after the
+	// first instruction that leaves the incremental hash out of step.
+	const auto RunTo = [&](uint64_t Target, bool CheckEach)
+	{
+		while( Console.GetCycles() < Target )
+		{
+			while( NextEvent < Events.size() && Events[NextEvent].Cycle <= Console.GetCycles() )
+			{
+				const Wunk8::ReplayEvent &Cur = Events[NextEvent++];
+				const uint16_t Key = static_cast<uint16_t>(1 << Cur.Key);
+				Cur.Pressed ? Console.KeyDown(Key) : Console.KeyUp(Key);
+			}
+			const uint32_t Slot = static_cast<uint32_t>(Console.GetCycles() % Test.InstructionsPerFrame);
+			Console.Tick(Wunk8::GetTickTime(Slot, Test.InstructionsPerFrame));
+			if( CheckEach && Console.GetStateHash() != Console.ComputeStateHash() )
+			{
+				return;
+			}
+		}
+	};
+
+	// Last step that matched, to replay from when narrowing down drift
+	Wunk8::Chip8 Matched(Console);
+	size_t MatchedEvent = NextEvent;
+	uint64_t Previous = 0;
+	for( const uint64_t Target : Test.Checkpoints )
+	{
+		for( uint64_t Step = 1; Step <= Subdivisions && Result.Failure.empty(); Step++ )
+		{
+			const uint64_t Count = Previous + (Target - Previous) * Step / Subdivisions;
+			if( Count == Console.GetCycles() && Step != Subdivisions )
+			{
+				continue;
+			}
+			RunTo(Count, false);
+			const Checkpoint Cur = { Console.GetScreenHash(), Console.GetStateHash() };
+			if( Cur.StateHash != Console.ComputeStateHash() )
+			{
+				Console.LoadState(Matched);
+				NextEvent = MatchedEvent;
+				RunTo(Count, true);
+				Result.Failure = "incremental hash drifted at " + std::to_string(Console.GetCycles());
+			}
+			else if( Update )
+			{
+				Result.Results.push_back(std::make_pair(Count, Cur));
+			}
+			else
+			{
+				const auto Found = Expected.find(std::make_pair(Test.Name, Count));
+				if( Found == Expected.end() )
+				{
+					Result.Failure = "no golden value at " + std::to_string(Count);
+				}
+				else if(
+					Found->second.ScreenHash != Cur.ScreenHash
+					|| Found->second.StateHash != Cur.StateHash
+				)
+				{
+					Result.Failure = std::string(
+						Found->second.ScreenHash != Cur.ScreenHash ? "screen" : "state"
+					) + " differs at " + std::to_string(Count)
+						+ ", last matched at " + std::to_string(Matched.GetCycles());
+				}
+			}
+			if( Result.Failure.empty() )
+			{
+				Matched.LoadState(Console);
+				MatchedEvent = NextEvent;
+			}
+		}
+		if( !Result.Failure.empty() )
+		{
+			const std::string Prefix = DumpDir + "/" + Test.Name + "-" + std::to_string(Console.GetCycles());
+			Result.Failure += DumpState(Console, Prefix)
+				? ", dumped " + Prefix + ".png/.state"
+				: ", unable to dump to " + DumpDir;
+			break;
+		}
+		Previous = Target;
+	}
+	return Result;
+}
+}
+
+int main(int argc, char *argv[])
+{
+	const char *CorpusPath = nullptr;
+	const char *GoldenPath = nullptr;
+	bool Update = false;
+	size_t Jobs = std::max(1u, std::thread::hardware_concurrency());
+	std::string DumpDir = ".";
+	for( int i = 1; i < argc; i++ )
+	{
+		const std::string Arg(argv[i]);
+		if( Arg == "--update" )
+		{
+			Update = true;
+		}
+		else if( Arg.compare(0, 7, "--jobs=") == 0 )
+		{
+			Jobs = std::max<size_t>(1, std::strtoul(Arg.c_str() + 7, nullptr, 10));
+		}
+		else if( Arg.compare(0, 7, "--dump=") == 0 )
+		{
+			DumpDir = Arg.substr(7);
+		}
+		else if( Arg[0] != '-' && CorpusPath == nullptr )
+		{
+			CorpusPath = argv[i];
+		}
+		else if( Arg[0] != '-' && GoldenPath == nullptr )
+		{
+			GoldenPath = argv[i];
+		}
+		else
+		{
+			PrintUsage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if( CorpusPath == nullptr || GoldenPath == nullptr )
+	{
+		PrintUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	std::vector<Case> Cases;
+	{
+		std::ifstream File(CorpusPath);
+		if( !File.good() )
+		{
+			std::cerr << "Unable to open " << CorpusPath << std::endl;
+			return EXIT_FAILURE;
+		}
+		std::string Line;
+		while( std::getline(File, Line) )
+		{
+			if( Line.empty() || Line[0] == '#' )
+			{
+				continue;
+			}
+			std::istringstream Fields(Line);
+			Case Cur;
+			std::string Checkpoints;
+			if(
+				!(Fields >> Cur.Name >> Cur.Rom >> Cur.Input >> Cur.InstructionsPerFrame >> Checkpoints)
+				|| Cur.InstructionsPerFrame == 0
+			)
+			{
+				std::cerr << "Malformed corpus line: " << Line << std::endl;
+				return EXIT_FAILURE;
+			}
+			std::istringstream Counts(Checkpoints);
+			std::string Count;
+			while( std::getline(Counts, Count, ',') )
+			{
+				Cur.Checkpoints.push_back(std::strtoull(Count.c_str(), nullptr, 10));
+			}
+			std::sort(Cur.Checkpoints.begin(), Cur.Checkpoints.end());
+			Cases.push_back(Cur);
+		}
+	}
+	const std::string Corpus(CorpusPath);
+	const size_t Slash = Corpus.find_last_of("/\\");
+	const std::string BaseDir = Slash == std::string::npos ? "" : Corpus.substr(0, Slash + 1);
+
+	Golden Expected;
+	if( !Update )
+	{
+		std::ifstream File(GoldenPath);
+		if( !File.good() )
+		{
+			std::cerr << "Unable to open " << GoldenPath << ", create it with --update" << std::endl;
+			return EXIT_FAILURE;
+		}
+		std::string Line;
+		while( std::getline(File, Line) )
+		{
+			std::istringstream Fields(Line);
+			std::string Name;
+			uint64_t Cycles;
+			Checkpoint Cur;
+			if(
+				!Line.empty() && Line[0] != '#'
+				&& (Fields >> Name >> Cycles >> std::hex >> Cur.ScreenHash >> Cur.StateHash)
+			)
+			{
+				Expected[std::make_pair(Name, Cycles)] = Cur;
+			}
+		}
+	}
+
+	std::vector<Outcome> Outcomes(Cases.size());
+	std::atomic<size_t> NextCase(0);
+	const auto Worker = [&]()
+	{
+		size_t Index;
+		while( (Index = NextCase.fetch_add(1)) < Cases.size() )
+		{
+			Outcomes[Index] = Run(Cases[Index], BaseDir, Expected, Update, DumpDir);
+		}
+	};
+	std::vector<std::thread> Workers;
+	for( size_t i = 1; i < std::min(Jobs, Cases.size()); i++ )
+	{
+		Workers.emplace_back(Worker);
+	}
+	Worker();
+	for( std::thread &Cur : Workers )
+	{
+		Cur.join();
+	}
+
+	size_t Failed = 0;
+	for( size_t i = 0; i < Cases.size(); i++ )
+	{
+		const Outcome &Cur = Outcomes[i];
+		if( !Cur.Error.empty() || !Cur.Failure.empty() )
+		{
+			Failed++;
+			std::cout << "FAIL " << Cases[i].Name << ": " << Cur.Error << Cur.Failure << std::endl;
+		}
+		else
+		{
+			std::cout << "ok   " << Cases[i].Name << std::endl;
+		}
+	}
+
+	// Not a corpus case, so it has no golden values to update
+	const std::string BootFailure = CheckBootImage();
+	if( !BootFailure.empty() )
+	{
+		Failed++;
+		std::cout << "FAIL boot-image: " << BootFailure << std::endl;
+	}
+	else
+	{
+		std::cout << "ok   boot-image" << std::endl;
+	}
+
+	if( Update && Failed == 0 )
+	{
+		std::ofstream File(GoldenPath, std::ios::trunc);
+		File << "# name instructions screen-hash state-hash, written by --update" << std::endl;
+		for( size_t i = 0; i < Cases.size(); i++ )
+		{
+			for( const std::pair<uint64_t, Checkpoint> &Cur : Outcomes[i].Results )
+			{
+				File
+					<< Cases[i].Name << ' ' << Cur.first << ' ' << std::hex
+					<< std::setfill('0') << std::setw(16) << Cur.second.ScreenHash << ' '
+					<< std::setw(16) << Cur.second.StateHash << std::dec << std::endl;
+			}
+		}
+		if( !File.good() )
+		{
+			std::cerr << "Failed to write " << GoldenPath << std::endl;
+			return EXIT_FAILURE;
+		}
+		std::cout << "Wrote " << GoldenPath << std::endl;
+	}
+	std::cout << Cases.size() + 1 - Failed << " of " << Cases.size() + 1 << " passed" << std::endl;
+	return Failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
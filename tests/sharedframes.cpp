@@ -0,0 +1,135 @@
+#include <iostream>
+#include <algorithm>
+#include <string>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Wunk8.hpp"
+#include "SharedFrames.hpp"
+
+// Publishes frames through a SharedFrames ring and reads them back the way
+// another process would, including frames the ring already overwrote and a
+// slot a dead writer left mid-write.
+namespace
+{
+constexpr uint32_t SlotCount = 4;
+
+bool Failed = false;
+
+void Check(bool Condition, const char *What)
+{
+	if( !Condition )
+	{
+		std::cout << "FAIL " << What << std::endl;
+		Failed = true;
+	}
+}
+
+// Draws font digit Digit so each frame has a different screen
+void DrawDigit(Wunk8::Chip8 &Console, uint8_t Digit)
+{
+	const uint8_t Program[] = {
+		0x00, 0xE0,
+		0x60, Digit,
+		0xF0, 0x29,
+		0xD1, 0x15,
+		0x12, 0x08
+	};
+	Console.Reset();
+	Console.LoadGame(Program, sizeof(Program));
+	for( size_t i = 0; i < 4; i++ )
+	{
+		Console.Tick(std::chrono::microseconds(0));
+	}
+}
+}
+
+int main()
+{
+	const std::string Name = "/wunk8-test-" + std::to_string(getpid());
+
+	Wunk8::SharedFrames::Writer Writer;
+	if( !Writer.Open(Name, SlotCount) )
+	{
+		std::cout << "Unable to create shared memory " << Name << std::endl;
+		return EXIT_FAILURE;
+	}
+	Wunk8::SharedFrames::Reader Reader;
+	if( !Reader.Open(Name) )
+	{
+		std::cout << "Unable to open shared memory " << Name << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	Wunk8::SharedFrames::CopiedFrame Frame;
+	Check(Reader.GetPublished() == 0, "empty ring has frames");
+	Check(!Reader.Read(0, Frame), "read a frame before it was published");
+
+	// Two laps around the ring, checking each frame as it lands
+	Wunk8::Chip8 Console;
+	const uint64_t FrameCount = SlotCount * 2 + 1;
+	uint64_t Hashes[FrameCount];
+	for( uint64_t i = 0; i < FrameCount; i++ )
+	{
+		DrawDigit(Console, static_cast<uint8_t>(i));
+		Hashes[i] = Console.GetStateHash();
+		Writer.Publish(Console);
+		Check(Reader.GetPublished() == i + 1, "published count");
+		Check(Reader.Read(i, Frame), "read the newest frame");
+		Check(Frame.Frame == i, "frame number");
+		Check(Frame.Cycles == Console.GetCycles(), "cycles");
+		Check(Frame.StateHash == Hashes[i], "state hash");
+		Check(
+			std::equal(Frame.Screen, Frame.Screen + sizeof(Frame.Screen), Console.GetScreen()),
+			"screen"
+		);
+	}
+
+	// Only the last lap is still in the ring
+	for( uint64_t i = 0; i < FrameCount; i++ )
+	{
+		const bool Kept = i + SlotCount >= FrameCount;
+		Check(Reader.Read(i, Frame) == Kept, Kept ? "read a kept frame" : "read an overwritten frame");
+		if( Kept )
+		{
+			Check(Frame.StateHash == Hashes[i], "kept frame hash");
+		}
+	}
+	Check(!Reader.Read(FrameCount, Frame), "read a frame past the newest");
+
+	// Leave the newest slot odd as a writer that died while publishing would
+	const int File = shm_open(Name.c_str(), O_RDWR, 0);
+	const size_t Size = Wunk8::SharedFrames::GetSize(SlotCount);
+	void *Mapped = File < 0 ? MAP_FAILED : mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_SHARED, File, 0);
+	if( File >= 0 )
+	{
+		close(File);
+	}
+	if( Mapped == MAP_FAILED )
+	{
+		std::cout << "Unable to map shared memory " << Name << std::endl;
+		return EXIT_FAILURE;
+	}
+	Wunk8::SharedFrames::Slot *Slots = reinterpret_cast<Wunk8::SharedFrames::Slot*>(
+		static_cast<Wunk8::SharedFrames::Header*>(Mapped) + 1
+	);
+	const uint64_t Newest = FrameCount - 1;
+	Wunk8::SharedFrames::Slot &Stuck = Slots[Newest % SlotCount];
+	Stuck.Sequence.fetch_add(1);
+	Check(!Reader.Read(Newest, Frame), "read a slot left mid-write");
+	Check(Reader.Read(Newest - 1, Frame), "read a neighbour of a slot left mid-write");
+	// The writer's next lap repairs the slot
+	Stuck.Sequence.fetch_add(1);
+	Check(Reader.Read(Newest, Frame), "read a slot after it was finished");
+	munmap(Mapped, Size);
+
+	if( Failed )
+	{
+		return EXIT_FAILURE;
+	}
+	std::cout << "PASS" << std::endl;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,603 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+#include "Wunk8.hpp"
+#include "Disassembler.hpp"
+#include "Replay.hpp"
+#include "TransitionCache.hpp"
+
+// Runs the reference interpreter and an accelerated engine side by side on
+// the same program and input, comparing their complete machine state and
+// narrowing any disagreement down to the first instruction that caused it.
+namespace
+{
+void PrintUsage(const char *Program)
+{
+	std::cout
+		<< "Usage: " << Program << " [options] (Chip8 ROM file)" << std::endl
+		<< "       " << Program << " [options] --fuzz=SEED" << std::endl
+		<< "Options:" << std::endl
+		<< "  --engine=NAME   Engine checked against the reference interpreter:" << std::endl
+		<< "                  cache(cache)" << std::endl
+		<< "  --replay=FILE   Input recorded by wunk8 --record-input" << std::endl
+		<< "  --cycles=N      Instructions to run(1000000, or 20000 per fuzzed program)" << std::endl
+		<< "  --ipf=N         Instructions per frame(10)" << std::endl
+		<< "  --seed=N        Random number seed of both consoles(0)" << std::endl
+		<< "  --interval=N    Most instructions between comparisons. Comparisons" << std::endl
+		<< "                  start every instruction and back off while the engines" << std::endl
+		<< "                  agree(4096)" << std::endl
+		<< "  --cache=N       Entries of the cache engine, small to exercise" << std::endl
+		<< "                  eviction(64)" << std::endl
+		<< "  --fuzz=SEED     Check random programs and input instead of a ROM," << std::endl
+		<< "                  the first made from SEED and each after from the next" << std::endl
+		<< "  --fuzz-count=N  Random programs to check(1000)" << std::endl
+		<< "  --trace=FILE    Upon divergence, write the reference's instructions since" << std::endl
+		<< "                  the last agreeing comparison to FILE. Requires building" << std::endl
+		<< "                  with WUNK8_TRACE. Decode with wunk8-trace." << std::endl;
+}
+
+// An implementation of the Chip8 that can be checked against the reference.
+// Engines may keep the machine in any form they like so long as they can
+// convert to and from a Chip8.
+class Engine
+{
+public:
+	virtual ~Engine() = default;
+
+	virtual const char* GetName() const = 0;
+
+	// Replaces the entire machine state
+	virtual void Load(const Wunk8::Chip8 &State) = 0;
+
+	// Runs Count instructions, spreading each frame over InstructionsPerFrame
+	// instructions the way the frontend does
+	virtual void Run(uint32_t Count) = 0;
+
+	virtual void SetKeys(uint16_t Keys) = 0;
+
+	virtual const Wunk8::Chip8& GetState() const = 0;
+};
+
+// Chip8::Tick, one instruction at a time
+class Reference : public Engine
+{
+public:
+	explicit Reference(uint32_t InstructionsPerFrame)
+		: InstructionsPerFrame(InstructionsPerFrame)
+	{
+	}
+
+	const char* GetName() const override
+	{
+		return "reference";
+	}
+
+	void Load(const Wunk8::Chip8 &State) override
+	{
+		Console.LoadState(State);
+	}
+
+	void Run(uint32_t Count) override
+	{
+		for( uint32_t i = 0; i < Count; i++ )
+		{
+			const uint32_t Slot = static_cast<uint32_t>(Console.GetCycles() % InstructionsPerFrame);
+			Console.Tick(Wunk8::GetTickTime(Slot, InstructionsPerFrame));
+		}
+	}
+
+	void SetKeys(uint16_t Keys) override
+	{
+		Console.KeyUp(0xFFFF);
+		Console.KeyDown(Keys);
+	}
+
+	const Wunk8::Chip8& GetState() const override
+	{
+		return Console;
+	}
+
+#if defined(WUNK8_TRACE)
+	void SetTracer(Wunk8::Tracer *Trace)
+	{
+		Console.SetTracer(Trace);
+	}
+#endif
+
+private:
+	const uint32_t InstructionsPerFrame;
+	Wunk8::Chip8 Console;
+};
+
+// TransitionCache, one run per frame like wunk8-search. The cache outlives
+// Load so that bisection replays against entries stored earlier.
+class Cached : public Engine
+{
+public:
+	Cached(uint32_t InstructionsPerFrame, size_t Capacity)
+		: InstructionsPerFrame(InstructionsPerFrame),
+		Cache(Capacity, InstructionsPerFrame)
+	{
+	}
+
+	const char* GetName() const override
+	{
+		return "cache";
+	}
+
+	void Load(const Wunk8::Chip8 &State) override
+	{
+		Console.LoadState(State);
+	}
+
+	void Run(uint32_t Count) override
+	{
+		while( Count != 0 )
+		{
+			const uint32_t Slot = static_cast<uint32_t>(Console.GetCycles() % InstructionsPerFrame);
+			const uint32_t Length = std::min(Count, InstructionsPerFrame - Slot);
+			Cache.Run(Console, Slot, Length);
+			Count -= Length;
+		}
+	}
+
+	void SetKeys(uint16_t Keys) override
+	{
+		Console.KeyUp(0xFFFF);
+		Console.KeyDown(Keys);
+	}
+
+	const Wunk8::Chip8& GetState() const override
+	{
+		return Console;
+	}
+
+	const Wunk8::TransitionCache::Stats& GetStats() const
+	{
+		return Cache.GetStats();
+	}
+
+private:
+	const uint32_t InstructionsPerFrame;
+	Wunk8::TransitionCache Cache;
+	Wunk8::Chip8 Console;
+};
+
+struct Divergence
+{
+	// Machine state at the last comparison the engines agreed on
+	Wunk8::Chip8 Checkpoint;
+	// Machine state just before the first instruction the engines disagree on
+	Wunk8::Chip8 Before;
+	Wunk8::Chip8 Expected;
+	Wunk8::Chip8 Actual;
+	const char *Part;
+};
+
+struct Checked
+{
+	uint64_t Instructions;
+	uint64_t Comparisons;
+};
+
+// Finds the smallest number of instructions from Start after which the
+// engines disagree, knowing that they agree after none and disagree after
+// Count. Engines are deterministic, so any prefix can be replayed from Start.
+uint32_t Bisect(Engine &Expected, Engine &Actual, const Wunk8::Chip8 &Start, uint32_t Count)
+{
+	uint32_t Agree = 0;
+	uint32_t Disagree = Count;
+	while( Disagree - Agree > 1 )
+	{
+		const uint32_t Middle = Agree + (Disagree - Agree) / 2;
+		Expected.Load(Start);
+		Actual.Load(Start);
+		Expected.Run(Middle);
+		Actual.Run(Middle);
+		if( Expected.GetState().FindDifference(Actual.GetState()) != nullptr )
+		{
+			Disagree = Middle;
+		}
+		else
+		{
+			Agree = Middle;
+		}
+	}
+	return Disagree;
+}
+
+// Runs both engines from Start for Cycles instructions. Comparisons begin
+// after every instruction and double their spacing up to MaxInterval for as
+// long as the engines agree, so long runs cost little more than running the
+// engines themselves. Input events always fall between runs.
+bool Lockstep(
+	Engine &Expected, Engine &Actual, const Wunk8::Chip8 &Start,
+	const std::vector<Wunk8::ReplayEvent> &Events, uint64_t Cycles, uint32_t MaxInterval,
+	Divergence &Found, Checked &Progress
+)
+{
+	Expected.Load(Start);
+	Actual.Load(Start);
+	Progress = { 0, 0 };
+	uint16_t Keys = Start.GetKeys();
+	uint32_t Interval = 1;
+	size_t NextEvent = 0;
+	const uint64_t End = Start.GetCycles() + Cycles;
+	std::unique_ptr<Wunk8::Chip8> Checkpoint(new Wunk8::Chip8());
+	while( Expected.GetState().GetCycles() < End )
+	{
+		const uint64_t Now = Expected.GetState().GetCycles();
+		const uint16_t Previous = Keys;
+		while( NextEvent < Events.size() && Events[NextEvent].Cycle <= Now )
+		{
+			const Wunk8::ReplayEvent &Cur = Events[NextEvent++];
+			const uint16_t Key = static_cast<uint16_t>(1 << Cur.Key);
+			Keys = Cur.Pressed ? (Keys | Key) : (Keys & ~Key);
+		}
+		if( Keys != Previous )
+		{
+			Expected.SetKeys(Keys);
+			Actual.SetKeys(Keys);
+		}
+
+		uint64_t Until = std::min(End, Now + Interval);
+		if( NextEvent < Events.size() )
+		{
+			Until = std::min(Until, Events[NextEvent].Cycle);
+		}
+		const uint32_t Count = static_cast<uint32_t>(Until - Now);
+		Checkpoint->LoadState(Expected.GetState());
+		Expected.Run(Count);
+		Actual.Run(Count);
+		Progress.Comparisons++;
+		if( Expected.GetState().FindDifference(Actual.GetState()) == nullptr )
+		{
+			Progress.Instructions += Count;
+			Interval = std::min(Interval * 2, MaxInterval);
+			continue;
+		}
+
+		Found.Checkpoint.LoadState(*Checkpoint);
+		uint32_t Diverged = Bisect(Expected, Actual, *Checkpoint, Count);
+		Expected.Load(*Checkpoint);
+		Expected.Run(Diverged - 1);
+		Found.Before.LoadState(Expected.GetState());
+		Expected.Run(1);
+		Actual.Load(*Checkpoint);
+		Actual.Run(Diverged);
+		Found.Part = Expected.GetState().FindDifference(Actual.GetState());
+		if( Found.Part == nullptr )
+		{
+			// Only reproduces when run in one piece, so report the whole run
+			Diverged = Count;
+			Found.Before.LoadState(*Checkpoint);
+			Expected.Load(*Checkpoint);
+			Actual.Load(*Checkpoint);
+			Expected.Run(Count);
+			Actual.Run(Count);
+			Found.Part = Expected.GetState().FindDifference(Actual.GetState());
+			if( Found.Part == nullptr )
+			{
+				Found.Part = "nothing when rerun, the engine is not deterministic";
+			}
+		}
+		Found.Expected.LoadState(Expected.GetState());
+		Found.Actual.LoadState(Actual.GetState());
+		Progress.Instructions += Diverged - 1;
+		return false;
+	}
+	return true;
+}
+
+void PrintDivergence(const Divergence &Found, const Engine &Expected, const Engine &Actual)
+{
+	const uint16_t PC = Found.Before.GetPC() & 0xFFF;
+	const uint8_t *Memory = Found.Before.GetMemory();
+	const uint16_t Opcode = static_cast<uint16_t>(
+		(Memory[PC] << 8) | Memory[(PC + 1) & 0xFFF]
+	);
+	std::cout
+		<< "Divergence at instruction " << Found.Before.GetCycles() << std::endl
+		<< "  PC 0x" << std::hex << std::setw(3) << std::setfill('0') << PC
+		<< ": " << std::setw(4) << Opcode << std::dec << std::setfill(' ')
+		<< " " << Wunk8::Disassemble(Opcode) << std::endl
+		<< "  " << Expected.GetName() << " and " << Actual.GetName()
+		<< " differ in " << Found.Part << std::endl
+		<< "  state hashes 0x" << std::hex
+		<< Found.Expected.GetStateHash() << " and 0x" << Found.Actual.GetStateHash()
+		<< std::dec << std::endl;
+}
+
+// Mostly well-formed instructions with addresses inside the program, so
+// control flow stays in generated code and every family gets exercised,
+// with some raw words for the encodings nobody writes on purpose
+std::vector<uint8_t> RandomProgram(std::mt19937 &Random, size_t Instructions)
+{
+	static const uint8_t Arithmetic[] = { 0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0xE };
+	static const uint8_t Misc[] = {
+		0x02, 0x07, 0x0A, 0x15, 0x18, 0x1E, 0x29, 0x33, 0x3A, 0x55, 0x65
+	};
+	std::uniform_int_distribution<uint32_t> Word(0, 0xFFFF);
+	std::vector<uint8_t> Bytes;
+	for( size_t i = 0; i < Instructions; i++ )
+	{
+		uint16_t Opcode = static_cast<uint16_t>(Word(Random));
+		const uint16_t Target = static_cast<uint16_t>(0x200 + 2 * (Word(Random) % Instructions));
+		if( Word(Random) % 16 != 0 )
+		{
+			switch( Opcode >> 12 )
+			{
+			case 0x0:
+				Opcode = Opcode & 1 ? 0x00E0 : 0x00EE;
+				break;
+			case 0x1:
+			case 0x2:
+			case 0xA:
+			case 0xB:
+				Opcode = static_cast<uint16_t>((Opcode & 0xF000) | Target);
+				break;
+			case 0x8:
+				Opcode = static_cast<uint16_t>(
+					(Opcode & 0xFFF0) | Arithmetic[Word(Random) % sizeof(Arithmetic)]
+				);
+				break;
+			case 0xE:
+				Opcode = static_cast<uint16_t>((Opcode & 0xFF00) | (Opcode & 1 ? 0x9E : 0xA1));
+				break;
+			case 0xF:
+				Opcode = static_cast<uint16_t>((Opcode & 0xFF00) | Misc[Word(Random) % sizeof(Misc)]);
+				break;
+			}
+		}
+		Bytes.push_back(static_cast<uint8_t>(Opcode >> 8));
+		Bytes.push_back(static_cast<uint8_t>(Opcode));
+	}
+	return Bytes;
+}
+
+std::vector<Wunk8::ReplayEvent> RandomInput(std::mt19937 &Random, uint64_t Cycles)
+{
+	std::uniform_int_distribution<uint64_t> Gap(1, 2000);
+	std::uniform_int_distribution<uint32_t> Key(0, 0xF);
+	std::vector<Wunk8::ReplayEvent> Events;
+	uint16_t Held = 0;
+	for( uint64_t Cycle = Gap(Random); Cycle < Cycles; Cycle += Gap(Random) )
+	{
+		const uint8_t Cur = static_cast<uint8_t>(Key(Random));
+		Events.push_back(Wunk8::ReplayEvent{ Cycle, Cur, !((Held >> Cur) & 1) });
+		Held ^= static_cast<uint16_t>(1 << Cur);
+	}
+	return Events;
+}
+
+#if defined(WUNK8_TRACE)
+// Replays the reference from the last agreeing checkpoint through the
+// diverging instruction with a tracer attached
+bool TraceDivergence(const Divergence &Found, uint32_t InstructionsPerFrame, const char *FileName)
+{
+	Wunk8::Tracer Trace;
+	Reference Replay(InstructionsPerFrame);
+	Replay.Load(Found.Checkpoint);
+	Replay.SetTracer(&Trace);
+	Replay.Run(static_cast<uint32_t>(
+		Found.Expected.GetCycles() - Found.Checkpoint.GetCycles()
+	));
+	Replay.SetTracer(nullptr);
+	return Trace.Flush(FileName);
+}
+#endif
+
+std::unique_ptr<Engine> MakeEngine(
+	const std::string &Name, uint32_t InstructionsPerFrame, size_t CacheSize
+)
+{
+	if( Name == "cache" )
+	{
+		return std::unique_ptr<Engine>(new Cached(InstructionsPerFrame, CacheSize));
+	}
+	return nullptr;
+}
+}
+
+int main(int argc, char *argv[])
+{
+	const char *RomName = nullptr;
+	std::string EngineName = "cache";
+	std::string ReplayPath;
+	uint64_t Cycles = 0;
+	uint32_t InstructionsPerFrame = 10;
+	uint32_t Seed = 0;
+	uint32_t MaxInterval = 4096;
+	size_t CacheSize = 64;
+	bool Fuzz = false;
+	uint32_t FuzzSeed = 0;
+	uint32_t FuzzCount = 1000;
+	std::string TracePath;
+	for( int i = 1; i < argc; i++ )
+	{
+		const std::string Arg(argv[i]);
+		if( Arg.compare(0, 9, "--engine=") == 0 )
+		{
+			EngineName = Arg.substr(9);
+		}
+		else if( Arg.compare(0, 9, "--replay=") == 0 )
+		{
+			ReplayPath = Arg.substr(9);
+		}
+		else if( Arg.compare(0, 9, "--cycles=") == 0 )
+		{
+			Cycles = std::strtoull(Arg.c_str() + 9, nullptr, 10);
+		}
+		else if( Arg.compare(0, 6, "--ipf=") == 0 )
+		{
+			InstructionsPerFrame = std::max<uint32_t>(
+				1, static_cast<uint32_t>(std::strtoul(Arg.c_str() + 6, nullptr, 10))
+			);
+		}
+		else if( Arg.compare(0, 7, "--seed=") == 0 )
+		{
+			Seed = static_cast<uint32_t>(std::strtoul(Arg.c_str() + 7, nullptr, 10));
+		}
+		else if( Arg.compare(0, 11, "--interval=") == 0 )
+		{
+			MaxInterval = std::max<uint32_t>(
+				1, static_cast<uint32_t>(std::strtoul(Arg.c_str() + 11, nullptr, 10))
+			);
+		}
+		else if( Arg.compare(0, 8, "--cache=") == 0 )
+		{
+			CacheSize = std::max<size_t>(1, std::strtoul(Arg.c_str() + 8, nullptr, 10));
+		}
+		else if( Arg.compare(0, 7, "--fuzz=") == 0 )
+		{
+			Fuzz = true;
+			FuzzSeed = static_cast<uint32_t>(std::strtoul(Arg.c_str() + 7, nullptr, 10));
+		}
+		else if( Arg.compare(0, 13, "--fuzz-count=") == 0 )
+		{
+			FuzzCount = static_cast<uint32_t>(std::strtoul(Arg.c_str() + 13, nullptr, 10));
+		}
+		else if( Arg.compare(0, 8, "--trace=") == 0 )
+		{
+#if defined(WUNK8_TRACE)
+			TracePath = Arg.substr(8);
+#else
+			std::cout << "Built without WUNK8_TRACE, --trace is unavailable" << std::endl;
+			return EXIT_FAILURE;
+#endif
+		}
+		else if( Arg[0] != '-' && RomName == nullptr )
+		{
+			RomName = argv[i];
+		}
+		else
+		{
+			PrintUsage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if( Fuzz == (RomName != nullptr) )
+	{
+		PrintUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	Reference Expected(InstructionsPerFrame);
+	std::unique_ptr<Engine> Actual = MakeEngine(EngineName, InstructionsPerFrame, CacheSize);
+	if( !Actual )
+	{
+		std::cerr << "Unknown engine: " << EngineName << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// Flushes the trace, if any, for a divergence just printed
+	const auto OnDivergence = [&](const Divergence &Cur)
+	{
+#if defined(WUNK8_TRACE)
+		if( TracePath.empty() )
+		{
+			return;
+		}
+		if( TraceDivergence(Cur, InstructionsPerFrame, TracePath.c_str()) )
+		{
+			std::cout << "Trace written to " << TracePath << std::endl;
+		}
+		else
+		{
+			std::cerr << "Unable to write " << TracePath << std::endl;
+		}
+#else
+		static_cast<void>(Cur);
+#endif
+	};
+
+	// Several machine states are a few kilobytes each, keep them off the stack
+	std::unique_ptr<Divergence> Found(new Divergence());
+	std::unique_ptr<Wunk8::Chip8> Start(new Wunk8::Chip8());
+	const auto Began = std::chrono::steady_clock::now();
+	Checked Progress;
+	if( !Fuzz )
+	{
+		*Start = Wunk8::Chip8(Seed);
+		if( !Start->LoadGame(std::string(RomName)) )
+		{
+			std::cerr << "Unable to open " << RomName << std::endl;
+			return EXIT_FAILURE;
+		}
+		std::vector<Wunk8::ReplayEvent> Events;
+		if( !ReplayPath.empty() && !Wunk8::ReadReplay(ReplayPath, Events) )
+		{
+			std::cerr << "Unable to open " << ReplayPath << std::endl;
+			return EXIT_FAILURE;
+		}
+		const bool Agreed = Lockstep(
+			Expected, *Actual, *Start, Events, Cycles ? Cycles : 1000000, MaxInterval,
+			*Found, Progress
+		);
+		if( !Agreed )
+		{
+			PrintDivergence(*Found, Expected, *Actual);
+			OnDivergence(*Found);
+			return EXIT_FAILURE;
+		}
+	}
+	else
+	{
+		const uint64_t FuzzCycles = Cycles ? Cycles : 20000;
+		uint64_t Instructions = 0;
+		uint64_t Comparisons = 0;
+		for( uint32_t Case = 0; Case < FuzzCount; Case++ )
+		{
+			const uint32_t CaseSeed = FuzzSeed + Case;
+			std::mt19937 Random(CaseSeed);
+			const std::vector<uint8_t> Program = RandomProgram(Random, 64 + Random() % 448);
+			const std::vector<Wunk8::ReplayEvent> Events = RandomInput(Random, FuzzCycles);
+			*Start = Wunk8::Chip8(CaseSeed);
+			Start->LoadGame(Program.data(), Program.size());
+			if( !Lockstep(Expected, *Actual, *Start, Events, FuzzCycles, MaxInterval, *Found, Progress) )
+			{
+				std::cout << "Fuzzed program " << CaseSeed << std::endl;
+				PrintDivergence(*Found, Expected, *Actual);
+				std::cout
+					<< "Reproduce with --fuzz=" << CaseSeed << " --fuzz-count=1"
+					<< " --cycles=" << FuzzCycles << " --ipf=" << InstructionsPerFrame
+					<< " --engine=" << EngineName << std::endl;
+				OnDivergence(*Found);
+				return EXIT_FAILURE;
+			}
+			Instructions += Progress.Instructions;
+			Comparisons += Progress.Comparisons;
+		}
+		Progress = { Instructions, Comparisons };
+	}
+
+	const double Seconds = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - Began
+	).count();
+	std::cout
+		<< Expected.GetName() << " and " << Actual->GetName() << " agreed on "
+		<< Progress.Instructions << " instructions";
+	if( Fuzz )
+	{
+		std::cout << " of " << FuzzCount << " programs";
+	}
+	std::cout
+		<< " with " << Progress.Comparisons << " comparisons in "
+		<< std::fixed << std::setprecision(2) << Seconds << "s" << std::endl;
+	if( const Cached *Cache = dynamic_cast<const Cached*>(Actual.get()) )
+	{
+		const Wunk8::TransitionCache::Stats &Stats = Cache->GetStats();
+		std::cout
+			<< "Cache: " << Stats.Hits << " hits, " << Stats.Misses << " misses, "
+			<< Stats.Bypassed << " bypassed, " << Stats.Skipped << " instructions skipped"
+			<< std::endl;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,582 @@
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+
+#include "Wunk8.hpp"
+#include "StateSet.hpp"
+#include "TransitionCache.hpp"
+
+// Explores input sequences from a starting state with breadth-first or beam
+// search, looking for states that maximize an objective or reach a goal, and
+// for softlocks where no input changes anything.
+namespace
+{
+void PrintUsage(const char *Program)
+{
+	std::cout
+		<< "Usage: " << Program << " [options] (Chip8 ROM file)" << std::endl
+		<< "Options:" << std::endl
+		<< "  --state=FILE    Start from a state written by wunk8 --save-state" << std::endl
+		<< "  --mode=beam|bfs Keep the best --beam states per step, or all of them" << std::endl
+		<< "  --beam=N        States kept per step in beam mode(256)" << std::endl
+		<< "  --depth=N       Steps to search(64)" << std::endl
+		<< "  --frames=N      Frames each step holds its input for(4)" << std::endl
+		<< "  --ipf=N         Instructions per frame(10)" << std::endl
+		<< "  --keys=HEX      Keys to try, such as 456d. Releasing all keys is" << std::endl
+		<< "                  always tried too(0123456789abcdef)" << std::endl
+		<< "  --objective=TERMS  Score to maximize, a comma separated sum of" << std::endl
+		<< "                  mem:ADDR and pixels, each optionally negated with -" << std::endl
+		<< "  --goal=mem:ADDR>=VALUE  Stop once a byte of memory reaches VALUE" << std::endl
+		<< "  --softlock=N    Report states whose memory and screen no input has" << std::endl
+		<< "                  changed for N steps(16)" << std::endl
+		<< "  --threads=N     Worker threads(all cores)" << std::endl
+		<< "  --max-states=N  Capacity of the visited state set(4194304)" << std::endl
+		<< "  --cache=N       Frames each thread remembers that ran without reading" << std::endl
+		<< "                  the keyboard, 0 to disable(1024)" << std::endl
+		<< "  --out=FILE      Write the best input sequence for wunk8 --replay" << std::endl;
+}
+
+struct Term
+{
+	enum class Kind
+	{
+		Memory,
+		Pixels
+	} Source;
+	uint16_t Address;
+	int64_t Weight;
+};
+
+bool ParseObjective(const std::string &Text, std::vector<Term> &Terms)
+{
+	size_t Start = 0;
+	while( Start <= Text.size() )
+	{
+		size_t End = Text.find(',', Start);
+		End = End == std::string::npos ? Text.size() : End;
+		std::string Part = Text.substr(Start, End - Start);
+		Term Cur = { Term::Kind::Pixels, 0, 1 };
+		if( !Part.empty() && Part[0] == '-' )
+		{
+			Cur.Weight = -1;
+			Part.erase(0, 1);
+		}
+		if( Part.compare(0, 4, "mem:") == 0 )
+		{
+			Cur.Source = Term::Kind::Memory;
+			Cur.Address = static_cast<uint16_t>(std::strtoul(Part.c_str() + 4, nullptr, 0) & 0xFFF);
+		}
+		else if( Part != "pixels" )
+		{
+			return false;
+		}
+		Terms.push_back(Cur);
+		Start = End + 1;
+	}
+	return true;
+}
+
+struct Goal
+{
+	bool Enabled;
+	uint16_t Address;
+	uint8_t Value;
+};
+
+bool ParseGoal(const std::string &Text, Goal &Result)
+{
+	const size_t Split = Text.find(">=");
+	if( Text.compare(0, 4, "mem:") != 0 || Split == std::string::npos )
+	{
+		return false;
+	}
+	Result.Enabled = true;
+	Result.Address = static_cast<uint16_t>(
+		std::strtoul(Text.substr(4, Split - 4).c_str(), nullptr, 0) & 0xFFF
+	);
+	Result.Value = static_cast<uint8_t>(std::strtoul(Text.c_str() + Split + 2, nullptr, 0));
+	return true;
+}
+
+int64_t Score(const Wunk8::Chip8 &Console, const std::vector<Term> &Terms)
+{
+	int64_t Result = 0;
+	for( const Term &Cur : Terms )
+	{
+		int64_t Value = 0;
+		if( Cur.Source == Term::Kind::Memory )
+		{
+			Value = Console.GetMemory()[Cur.Address];
+		}
+		else
+		{
+			const uint8_t *Screen = Console.GetScreen();
+			for( size_t i = 0; i < Wunk8::Chip8::Width * Wunk8::Chip8::Height; i++ )
+			{
+				Value += Screen[i];
+			}
+		}
+		Result += Cur.Weight * Value;
+	}
+	return Result;
+}
+
+// Sentinel for releasing every key
+constexpr uint8_t NoKey = 0xFF;
+
+struct Node
+{
+	Wunk8::Chip8 State;
+	uint64_t Hash;
+	// Index into the step history, which leads back to the start
+	uint32_t Step;
+	int64_t Score;
+	// Consecutive steps in which no input changed memory or screen
+	uint32_t Stuck;
+};
+
+// One taken input, linked to the step before it
+struct Step
+{
+	uint32_t Parent;
+	uint8_t Key;
+};
+
+constexpr uint32_t NoParent = 0xFFFFFFFF;
+
+std::vector<uint8_t> GetPath(const std::vector<Step> &History, uint32_t Index)
+{
+	std::vector<uint8_t> Keys;
+	for( ; Index != NoParent; Index = History[Index].Parent )
+	{
+		Keys.push_back(History[Index].Key);
+	}
+	std::reverse(Keys.begin(), Keys.end());
+	return Keys;
+}
+
+void PrintPath(std::ostream &Out, const std::vector<uint8_t> &Keys)
+{
+	for( const uint8_t Key : Keys )
+	{
+		Out << (Key == NoKey ? '.' : "0123456789abcdef"[Key]);
+	}
+}
+}
+
+int main(int argc, char *argv[])
+{
+	const char *RomName = nullptr;
+	std::string StatePath;
+	std::string OutPath;
+	bool Beam = true;
+	size_t BeamWidth = 256;
+	uint32_t Depth = 64;
+	uint32_t FramesPerStep = 4;
+	uint32_t InstructionsPerFrame = 10;
+	std::vector<uint8_t> Actions = { NoKey };
+	std::string KeyList = "0123456789abcdef";
+	std::vector<Term> Objective;
+	Goal Target = { false, 0, 0 };
+	uint32_t SoftlockSteps = 16;
+	size_t ThreadCount = std::max(1u, std::thread::hardware_concurrency());
+	size_t MaxStates = 1 << 22;
+	size_t CacheSize = 1024;
+	for( int i = 1; i < argc; i++ )
+	{
+		const std::string Arg(argv[i]);
+		if( Arg.compare(0, 8, "--state=") == 0 )
+		{
+			StatePath = Arg.substr(8);
+		}
+		else if( Arg == "--mode=beam" || Arg == "--mode=bfs" )
+		{
+			Beam = Arg == "--mode=beam";
+		}
+		else if( Arg.compare(0, 7, "--beam=") == 0 )
+		{
+			BeamWidth = std::strtoul(Arg.c_str() + 7, nullptr, 10);
+		}
+		else if( Arg.compare(0, 8, "--depth=") == 0 )
+		{
+			Depth = static_cast<uint32_t>(std::strtoul(Arg.c_str() + 8, nullptr, 10));
+		}
+		else if( Arg.compare(0, 9, "--frames=") == 0 )
+		{
+			FramesPerStep = static_cast<uint32_t>(std::strtoul(Arg.c_str() + 9, nullptr, 10));
+		}
+		else if( Arg.compare(0, 6, "--ipf=") == 0 )
+		{
+			InstructionsPerFrame = static_cast<uint32_t>(std::strtoul(Arg.c_str() + 6, nullptr, 10));
+		}
+		else if( Arg.compare(0, 7, "--keys=") == 0 )
+		{
+			KeyList = Arg.substr(7);
+		}
+		else if( Arg.compare(0, 12, "--objective=") == 0 )
+		{
+			if( !ParseObjective(Arg.substr(12), Objective) )
+			{
+				std::cerr << "Unknown objective: " << Arg.substr(12) << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+		else if( Arg.compare(0, 7, "--goal=") == 0 )
+		{
+			if( !ParseGoal(Arg.substr(7), Target) )
+			{
+				std::cerr << "Unknown goal: " << Arg.substr(7) << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+		else if( Arg.compare(0, 11, "--softlock=") == 0 )
+		{
+			SoftlockSteps = static_cast<uint32_t>(std::strtoul(Arg.c_str() + 11, nullptr, 10));
+		}
+		else if( Arg.compare(0, 10, "--threads=") == 0 )
+		{
+			ThreadCount = std::max<size_t>(1, std::strtoul(Arg.c_str() + 10, nullptr, 10));
+		}
+		else if( Arg.compare(0, 13, "--max-states=") == 0 )
+		{
+			MaxStates = std::strtoul(Arg.c_str() + 13, nullptr, 10);
+		}
+		else if( Arg.compare(0, 8, "--cache=") == 0 )
+		{
+			CacheSize = std::strtoul(Arg.c_str() + 8, nullptr, 10);
+		}
+		else if( Arg.compare(0, 6, "--out=") == 0 )
+		{
+			OutPath = Arg.substr(6);
+		}
+		else if( Arg[0] != '-' && RomName == nullptr )
+		{
+			RomName = argv[i];
+		}
+		else
+		{
+			PrintUsage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if( RomName == nullptr || InstructionsPerFrame == 0 || FramesPerStep == 0 )
+	{
+		PrintUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	for( const char Key : KeyList )
+	{
+		const std::string Digit(1, Key);
+		char *End = nullptr;
+		const unsigned long Value = std::strtoul(Digit.c_str(), &End, 16);
+		if( *End != '\0' )
+		{
+			std::cerr << "Unknown key: " << Key << std::endl;
+			return EXIT_FAILURE;
+		}
+		Actions.push_back(static_cast<uint8_t>(Value));
+	}
+
+	std::vector<Node> Frontier(1);
+	Node &Start = Frontier[0];
+	if( !Start.State.LoadGame(std::string(RomName)) )
+	{
+		std::cerr << "Failed to load " << RomName << std::endl;
+		return EXIT_FAILURE;
+	}
+	if( !StatePath.empty() && !Start.State.LoadStateFile(StatePath) )
+	{
+		std::cerr << "Failed to load state from " << StatePath << std::endl;
+		return EXIT_FAILURE;
+	}
+	Start.Hash = Start.State.GetStateHash();
+	Start.Step = NoParent;
+	Start.Score = Score(Start.State, Objective);
+	Start.Stuck = 0;
+	const uint64_t StartCycle = Start.State.GetCycles();
+
+	Wunk8::StateSet Visited(MaxStates);
+	Visited.Insert(Start.Hash);
+	std::vector<Step> History;
+
+	Node Best = Start;
+	uint32_t GoalStep = NoParent;
+	std::vector<uint32_t> Softlocks;
+	std::vector<uint32_t> FixedPoints;
+
+	const uint32_t StepInstructions = FramesPerStep * InstructionsPerFrame;
+	// Children of one parent often never read the key they were given, so
+	// all but the first of them are replayed from the cache
+	std::vector<std::unique_ptr<Wunk8::TransitionCache>> Caches(ThreadCount);
+	for( size_t i = 0; CacheSize != 0 && i < ThreadCount; i++ )
+	{
+		Caches[i].reset(
+			new Wunk8::TransitionCache(CacheSize, InstructionsPerFrame)
+		);
+	}
+	const auto StartTime = std::chrono::steady_clock::now();
+	for( uint32_t CurDepth = 0; CurDepth < Depth && !Frontier.empty(); CurDepth++ )
+	{
+		// Every child gets a step in the history, kept or not, so indices
+		// are known up front without synchronizing
+		const uint32_t HistoryBase = static_cast<uint32_t>(History.size());
+		History.resize(History.size() + Frontier.size() * Actions.size());
+
+		std::atomic<size_t> NextParent(0);
+		std::vector<std::vector<Node>> Results(ThreadCount);
+		std::vector<std::vector<uint32_t>> Stuck(ThreadCount);
+		std::vector<std::vector<uint32_t>> Fixed(ThreadCount);
+		const auto Expand = [&](size_t Worker)
+		{
+			Node Child;
+			size_t ParentIndex;
+			while( (ParentIndex = NextParent.fetch_add(1)) < Frontier.size() )
+			{
+				const Node &Parent = Frontier[ParentIndex];
+				const uint64_t ParentHash = Parent.State.GetStateHash();
+				const uint64_t ParentContent =
+					Parent.State.GetMemoryHash() ^ Parent.State.GetScreenHash();
+				uint64_t FirstHash = 0;
+				bool InputMatters = false;
+				bool Changed = false;
+				size_t FirstChild = Results[Worker].size();
+				for( size_t Action = 0; Action < Actions.size(); Action++ )
+				{
+					const uint32_t StepIndex = static_cast<uint32_t>(
+						HistoryBase + ParentIndex * Actions.size() + Action
+					);
+					History[StepIndex] = { Parent.Step, Actions[Action] };
+
+					Child.State = Parent.State;
+					Child.State.KeyUp(0xFFFF);
+					if( Actions[Action] != NoKey )
+					{
+						Child.State.KeyDown(static_cast<uint16_t>(1 << Actions[Action]));
+					}
+					if( Caches[Worker] )
+					{
+						for( uint32_t Frame = 0; Frame < FramesPerStep; Frame++ )
+						{
+							Caches[Worker]->Run(Child.State, 0, InstructionsPerFrame);
+						}
+					}
+					else
+					{
+						for( uint32_t i = 0; i < StepInstructions; i++ )
+						{
+							const uint32_t Slot = i % InstructionsPerFrame;
+							Child.State.Tick(Wunk8::GetTickTime(Slot, InstructionsPerFrame));
+						}
+					}
+					// Released keys are not part of the state hash, so
+					// children that differ only in input still deduplicate
+					Child.State.KeyUp(0xFFFF);
+
+					const uint64_t Hash = Child.State.GetStateHash();
+					InputMatters |= Action != 0 && Hash != FirstHash;
+					FirstHash = Action == 0 ? Hash : FirstHash;
+					Changed |=
+						(Child.State.GetMemoryHash() ^ Child.State.GetScreenHash()) != ParentContent;
+
+					// Visited only changes between steps, so every thread sees
+					// the same answer here
+					if( Visited.Contains(Hash) )
+					{
+						continue;
+					}
+					// Siblings that ignored their input reached the same state
+					bool Duplicate = false;
+					for( size_t i = FirstChild; i < Results[Worker].size() && !Duplicate; i++ )
+					{
+						Duplicate = Results[Worker][i].Hash == Hash;
+					}
+					if( Duplicate )
+					{
+						continue;
+					}
+					Child.Hash = Hash;
+					Child.Step = StepIndex;
+					Child.Score = Score(Child.State, Objective);
+					Results[Worker].push_back(Child);
+				}
+				// Every input leads back to this very state
+				if( !InputMatters && FirstHash == ParentHash )
+				{
+					Fixed[Worker].push_back(Parent.Step);
+				}
+				const uint32_t StuckSteps = !InputMatters && !Changed ? Parent.Stuck + 1 : 0;
+				for( size_t i = FirstChild; i < Results[Worker].size(); i++ )
+				{
+					Results[Worker][i].Stuck = StuckSteps;
+				}
+				if( SoftlockSteps != 0 && StuckSteps == SoftlockSteps )
+				{
+					Stuck[Worker].push_back(Parent.Step);
+				}
+			}
+		};
+		std::vector<std::thread> Workers;
+		for( size_t i = 1; i < ThreadCount; i++ )
+		{
+			Workers.emplace_back(Expand, i);
+		}
+		Expand(0);
+		for( std::thread &Worker : Workers )
+		{
+			Worker.join();
+		}
+
+		Frontier.clear();
+		for( size_t i = 0; i < ThreadCount; i++ )
+		{
+			Frontier.insert(Frontier.end(), Results[i].begin(), Results[i].end());
+			Softlocks.insert(Softlocks.end(), Stuck[i].begin(), Stuck[i].end());
+			FixedPoints.insert(FixedPoints.end(), Fixed[i].begin(), Fixed[i].end());
+		}
+		// Children of different parents may reach the same state. Keep the
+		// one earliest in history rather than whichever thread got there
+		// first, and only then mark the survivors visited.
+		std::sort(
+			Frontier.begin(), Frontier.end(),
+			[](const Node &A, const Node &B)
+			{
+				return A.Hash != B.Hash ? A.Hash < B.Hash : A.Step < B.Step;
+			}
+		);
+		Frontier.erase(
+			std::unique(
+				Frontier.begin(), Frontier.end(),
+				[](const Node &A, const Node &B) { return A.Hash == B.Hash; }
+			),
+			Frontier.end()
+		);
+		bool Overflow = false;
+		Frontier.erase(
+			std::remove_if(
+				Frontier.begin(), Frontier.end(),
+				[&](const Node &Cur)
+				{
+					const Wunk8::StateSet::Result Inserted = Visited.Insert(Cur.Hash);
+					Overflow |= Inserted == Wunk8::StateSet::Result::Full;
+					return Inserted != Wunk8::StateSet::Result::Inserted;
+				}
+			),
+			Frontier.end()
+		);
+		// Highest scores first, ties broken by history so results do not
+		// depend on thread scheduling
+		std::sort(
+			Frontier.begin(), Frontier.end(),
+			[](const Node &A, const Node &B)
+			{
+				return A.Score != B.Score ? A.Score > B.Score : A.Step < B.Step;
+			}
+		);
+		if( Beam && Frontier.size() > BeamWidth )
+		{
+			Frontier.resize(BeamWidth);
+		}
+		// Prefer longer sequences among equal scores
+		if( !Frontier.empty() && Frontier[0].Score >= Best.Score )
+		{
+			Best = Frontier[0];
+		}
+		for( const Node &Cur : Frontier )
+		{
+			if( Target.Enabled && Cur.State.GetMemory()[Target.Address] >= Target.Value )
+			{
+				GoalStep = Cur.Step;
+				Best = Cur;
+				break;
+			}
+		}
+
+		const std::chrono::duration<double> Elapsed = std::chrono::steady_clock::now() - StartTime;
+		std::cout
+			<< "depth " << CurDepth + 1 << ": " << Frontier.size() << " states, "
+			<< Visited.Size() << " visited, best score " << Best.Score << ", "
+			<< Elapsed.count() << "s" << std::endl;
+		if( GoalStep != NoParent )
+		{
+			break;
+		}
+		if( Overflow )
+		{
+			std::cerr << "Visited state set is full, raise --max-states" << std::endl;
+			break;
+		}
+	}
+
+	for( const uint32_t Index : FixedPoints )
+	{
+		std::cout << "softlock, no input changes the state after: ";
+		PrintPath(std::cout, GetPath(History, Index));
+		std::cout << std::endl;
+	}
+	for( const uint32_t Index : Softlocks )
+	{
+		std::cout << "possible softlock, no input changed memory or screen for "
+			<< SoftlockSteps << " steps after: ";
+		PrintPath(std::cout, GetPath(History, Index));
+		std::cout << std::endl;
+	}
+
+	if( CacheSize != 0 )
+	{
+		Wunk8::TransitionCache::Stats Total = { 0, 0, 0, 0 };
+		for( const std::unique_ptr<Wunk8::TransitionCache> &Cache : Caches )
+		{
+			Total.Hits += Cache->GetStats().Hits;
+			Total.Misses += Cache->GetStats().Misses;
+			Total.Bypassed += Cache->GetStats().Bypassed;
+			Total.Skipped += Cache->GetStats().Skipped;
+		}
+		std::cout
+			<< "cache: " << Total.Hits << " hits, " << Total.Misses << " misses, "
+			<< Total.Bypassed << " read input, " << Total.Skipped
+			<< " instructions skipped" << std::endl;
+	}
+
+	const std::vector<uint8_t> Path = GetPath(History, Best.Step);
+	std::cout << (GoalStep != NoParent ? "goal reached: " : "best: ");
+	PrintPath(std::cout, Path);
+	std::cout << " (score " << Best.Score << ")" << std::endl;
+
+	if( !OutPath.empty() )
+	{
+		// Same "cycle key down|up" lines that wunk8 --record-input writes
+		std::ofstream Out(OutPath);
+		uint8_t Held = NoKey;
+		for( size_t i = 0; i <= Path.size(); i++ )
+		{
+			const uint64_t Cycle = StartCycle + i * StepInstructions;
+			const uint8_t Key = i < Path.size() ? Path[i] : NoKey;
+			if( Key == Held )
+			{
+				continue;
+			}
+			if( Held != NoKey )
+			{
+				Out << Cycle << ' ' << std::hex << unsigned(Held) << std::dec << " up\n";
+			}
+			if( Key != NoKey )
+			{
+				Out << Cycle << ' ' << std::hex << unsigned(Key) << std::dec << " down\n";
+			}
+			Held = Key;
+		}
+		if( !Out.good() )
+		{
+			std::cerr << "Failed to write " << OutPath << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	return GoalStep != NoParent || !Target.Enabled ? EXIT_SUCCESS : EXIT_FAILURE;
+}
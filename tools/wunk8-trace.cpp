@@ -0,0 +1,71 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+#include <stdio.h>
+#include <string.h>
+
+#include "Tracer.hpp"
+#include "Disassembler.hpp"
+
+// Decodes a binary execution trace written by Wunk8::Tracer into text
+int main(int argc, char *argv[])
+{
+	if( argc < 2 || argc > 3 )
+	{
+		std::cout
+			<< "Usage: " << argv[0] << " (trace file) [last N records]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::ifstream fIn(argv[1], std::ios::binary);
+	Wunk8::TraceHeader Header;
+	if( !fIn.read(reinterpret_cast<char*>(&Header), sizeof(Header))
+		|| memcmp(Header.Magic, Wunk8::Tracer::Magic, sizeof(Header.Magic)) != 0 )
+	{
+		std::cerr << argv[1] << ": not a Wunk8 trace" << std::endl;
+		return EXIT_FAILURE;
+	}
+	if( Header.Version != Wunk8::Tracer::Version
+		|| Header.RecordSize != sizeof(Wunk8::TraceRecord) )
+	{
+		std::cerr
+			<< argv[1] << ": unsupported trace version " << Header.Version
+			<< std::endl;
+		return EXIT_FAILURE;
+	}
+
+	uint32_t Skip = 0;
+	if( argc == 3 )
+	{
+		const uint32_t Last = static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10));
+		Skip = Header.Count > Last ? Header.Count - Last : 0;
+	}
+	fIn.seekg(static_cast<std::streamoff>(Skip) * sizeof(Wunk8::TraceRecord), std::ios::cur);
+
+	std::cout << "       cycle    pc  opcode  instruction        changes" << std::endl;
+	char Line[128];
+	Wunk8::TraceRecord Record;
+	for( uint32_t i = Skip; i < Header.Count; i++ )
+	{
+		if( !fIn.read(reinterpret_cast<char*>(&Record), sizeof(Record)) )
+		{
+			std::cerr << argv[1] << ": truncated after " << i << " records" << std::endl;
+			return EXIT_FAILURE;
+		}
+		int Length = snprintf(
+			Line, sizeof(Line), "%12llu  %03X    %04X  %-18s I=%03X",
+			static_cast<unsigned long long>(Record.Cycle), Record.PC,
+			Record.Opcode, Wunk8::Disassemble(Record.Opcode).c_str(), Record.I
+		);
+		if( Record.Register != Wunk8::Tracer::NoRegister && Length > 0 )
+		{
+			snprintf(
+				Line + Length, sizeof(Line) - Length, " V%X=%02X",
+				Record.Register, Record.Value
+			);
+		}
+		std::cout << Line << '\n';
+	}
+	return EXIT_SUCCESS;
+}